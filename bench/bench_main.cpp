@@ -0,0 +1,677 @@
+/**
+    Headless throughput benchmark: N game objects sharing M models are rendered for a fixed number of
+    frames and CPU/GPU frame time statistics are printed as JSON on stdout, engine diagnostics go to stderr.
+    Runs on any Vulkan implementation, including software drivers such as Mesa lavapipe.
+
+    usage: VulkanBench [--objects N] [--models M] [--frames F] [--warmup W] [--width X] [--height Y] [--mode instanced|per-object|indirect|ecs|secondary] [--cpu-cull off|on|bvh] [--hierarchy D] [--workers N] [--output file.json] [--trace trace.json]
+*/
+
+#include "lve_cpu_profiler.hpp"
+#include "lve_bvh.hpp"
+#include "lve_device.hpp"
+#include "lve_frustum_culler.hpp"
+#include "lve_game_object.hpp"
+#include "lve_job_system.hpp"
+#include "lve_pipeline_registry.hpp"
+#include "lve_registry.hpp"
+#include "lve_renderer.hpp"
+#include "lve_scene_graph.hpp"
+#include "lve_simulation.hpp"
+#include "lve_transform_store.hpp"
+#include "lve_upload_queue.hpp"
+#include "indirect_render_system.hpp"
+#include "simple_render_system.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+    enum class RenderMode
+    {
+        Instanced,
+        PerObject,
+        Indirect,
+        Entities,   // instanced, scene kept in an LveRegistry
+        Secondary   // per-object, recorded into secondary command buffers on the job system
+    };
+
+    const char* renderModeName(RenderMode mode)
+    {
+        switch (mode)
+        {
+            case RenderMode::Instanced: return "instanced";
+            case RenderMode::PerObject: return "per-object";
+            case RenderMode::Indirect: return "indirect";
+            case RenderMode::Entities: return "ecs";
+            case RenderMode::Secondary: return "secondary";
+        }
+        return "unknown";
+    }
+
+    // CPU frustum culling in front of the instanced/per-object paths
+    enum class CpuCull
+    {
+        Off,
+        Linear,   // LveFrustumCuller over every object
+        Bvh       // LveBvh refit with the moved objects, then queried
+    };
+
+    struct BenchConfig
+    {
+        uint32_t object_count = 10000;
+        uint32_t model_count = 16;
+        uint32_t frame_count = 500;
+        uint32_t warmup_frames = 20;
+        uint32_t width = 800;
+        uint32_t height = 600;
+        RenderMode mode = RenderMode::Instanced;
+        CpuCull cpu_cull = CpuCull::Off;
+        uint32_t hierarchy_depth = 0;   // objects form chains of this many nodes in an LveSceneGraph, 0 keeps them flat
+        uint32_t worker_count = lve::LveJobSystem::getDefaultWorkerCount();   // 0 keeps all per-frame work on the main thread
+        std::string output_path{};
+        std::string trace_path{};   // Chrome trace of the CPU zones, empty to disable
+    };
+
+    struct Summary
+    {
+        double min = 0.0;
+        double avg = 0.0;
+        double p50 = 0.0;
+        double p99 = 0.0;
+        double max = 0.0;
+    };
+
+    BenchConfig parseArgs(int argc, char** argv)
+    {
+        BenchConfig config{};
+        for (int i = 1; i < argc; i++)
+        {
+            const std::string arg = argv[i];
+            if (i + 1 >= argc)
+            {
+                throw std::runtime_error("missing value for argument " + arg);
+            }
+            const std::string value = argv[++i];
+
+            if (arg == "--objects") config.object_count = static_cast<uint32_t>(std::stoul(value));
+            else if (arg == "--models") config.model_count = static_cast<uint32_t>(std::stoul(value));
+            else if (arg == "--frames") config.frame_count = static_cast<uint32_t>(std::stoul(value));
+            else if (arg == "--warmup") config.warmup_frames = static_cast<uint32_t>(std::stoul(value));
+            else if (arg == "--width") config.width = static_cast<uint32_t>(std::stoul(value));
+            else if (arg == "--height") config.height = static_cast<uint32_t>(std::stoul(value));
+            else if (arg == "--mode" && value == "instanced") config.mode = RenderMode::Instanced;
+            else if (arg == "--mode" && value == "per-object") config.mode = RenderMode::PerObject;
+            else if (arg == "--mode" && value == "indirect") config.mode = RenderMode::Indirect;
+            else if (arg == "--mode" && value == "ecs") config.mode = RenderMode::Entities;
+            else if (arg == "--mode" && value == "secondary") config.mode = RenderMode::Secondary;
+            else if (arg == "--cpu-cull" && value == "off") config.cpu_cull = CpuCull::Off;
+            else if (arg == "--cpu-cull" && value == "on") config.cpu_cull = CpuCull::Linear;
+            else if (arg == "--cpu-cull" && value == "bvh") config.cpu_cull = CpuCull::Bvh;
+            else if (arg == "--hierarchy") config.hierarchy_depth = static_cast<uint32_t>(std::stoul(value));
+            else if (arg == "--workers") config.worker_count = static_cast<uint32_t>(std::stoul(value));
+            else if (arg == "--output") config.output_path = value;
+            else if (arg == "--trace") config.trace_path = value;
+            else throw std::runtime_error("unknown argument " + arg);
+        }
+
+        if (config.object_count < 1 || config.object_count > 1000000)
+        {
+            throw std::runtime_error("--objects must be between 1 and 1000000");
+        }
+        if (config.model_count < 1 || config.frame_count < 1)
+        {
+            throw std::runtime_error("--models and --frames must be at least 1");
+        }
+        if (config.mode == RenderMode::Entities && config.cpu_cull == CpuCull::Bvh)
+        {
+            throw std::runtime_error("--cpu-cull bvh is keyed by game object ids and cannot be used with --mode ecs");
+        }
+        if (config.hierarchy_depth == 1)
+        {
+            throw std::runtime_error("--hierarchy must be 0 (flat) or at least 2");
+        }
+        if (config.hierarchy_depth > 0 && (config.mode != RenderMode::Instanced || config.cpu_cull != CpuCull::Off))
+        {
+            throw std::runtime_error("--hierarchy draws the scene graph's world matrices and needs --mode instanced with --cpu-cull off");
+        }
+        return config;
+    }
+
+    Summary summarize(std::vector<double> samples)
+    {
+        Summary summary{};
+        if (samples.empty())
+        {
+            return summary;
+        }
+
+        std::sort(samples.begin(), samples.end());
+        auto percentile = [&samples](double p)
+        {
+            const size_t rank = static_cast<size_t>(std::ceil(p * samples.size()));
+            return samples[std::min(samples.size() - 1, rank == 0 ? 0 : rank - 1)];
+        };
+
+        summary.min = samples.front();
+        summary.max = samples.back();
+        summary.avg = std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+        summary.p50 = percentile(0.50);
+        summary.p99 = percentile(0.99);
+        return summary;
+    }
+
+    // quoted JSON string, text like the driver's device name may contain quotes, backslashes or control characters
+    void writeString(std::ostream& out, const char* text)
+    {
+        out << '"';
+        for (const char* c = text; *c != '\0'; c++)
+        {
+            switch (*c)
+            {
+                case '"': out << "\\\""; break;
+                case '\\': out << "\\\\"; break;
+                case '\n': out << "\\n"; break;
+                case '\r': out << "\\r"; break;
+                case '\t': out << "\\t"; break;
+                default:
+                    if (static_cast<unsigned char>(*c) < 0x20)
+                    {
+                        const char* hex_digits = "0123456789abcdef";
+                        out << "\\u00" << hex_digits[(*c >> 4) & 0xf] << hex_digits[*c & 0xf];
+                    }
+                    else
+                    {
+                        out << *c;
+                    }
+            }
+        }
+        out << '"';
+    }
+
+    void writeSummary(std::ostream& out, const char* name, const Summary& summary, bool available = true)
+    {
+        out << "    \"" << name << "\": ";
+        if (!available)
+        {
+            out << "null";
+            return;
+        }
+        out << "{\"min\": " << summary.min << ", \"avg\": " << summary.avg << ", \"p50\": " << summary.p50
+            << ", \"p99\": " << summary.p99 << ", \"max\": " << summary.max << "}";
+    }
+
+    // a unit cube whose face colors are tinted per model so the models are not byte-identical
+    lve::LveModel::Builder buildSyntheticModel(uint32_t model_index)
+    {
+        const float tint = 0.2f + 0.8f * static_cast<float>(model_index % 8) / 7.0f;
+        const glm::vec3 face_colors[6] = {
+            {.9f * tint, .9f, .9f}, {.8f, .8f * tint, .1f}, {.9f, .6f, .1f * tint},
+            {.8f * tint, .1f, .1f}, {.1f, .1f * tint, .8f}, {.1f, .8f, .1f * tint}
+        };
+
+        // each face as two triangles, corners given as (axis, sign) permutations of the unit cube
+        std::vector<lve::LveModel::Vertex> triangle_list{};
+        for (int face = 0; face < 6; face++)
+        {
+            const int axis = face / 2;
+            const float sign = (face % 2 == 0) ? -.5f : .5f;
+            const int u = (axis + 1) % 3;
+            const int v = (axis + 2) % 3;
+            const float corners[6][2] = {{-.5f, -.5f}, {.5f, .5f}, {-.5f, .5f}, {-.5f, -.5f}, {.5f, -.5f}, {.5f, .5f}};
+            for (const auto& corner : corners)
+            {
+                glm::vec3 position{};
+                position[axis] = sign;
+                position[u] = corner[0];
+                position[v] = corner[1];
+                triangle_list.push_back({position, face_colors[face]});
+            }
+        }
+
+        lve::LveModel::Builder builder{};
+        builder.loadTriangleList(triangle_list);
+        return builder;
+    }
+
+    // the instanced and indirect paths stream per-object data through the frame ring buffer, so it has to grow
+    // with --objects; the per-object modes never touch it and keep the renderer's default
+    VkDeviceSize frameRingBufferSize(const BenchConfig& config)
+    {
+        VkDeviceSize bytes_per_object = 0;
+        switch (config.mode)
+        {
+            case RenderMode::Instanced:
+            case RenderMode::Entities: bytes_per_object = lve::SimpleRenderSystem::FRAME_RING_BYTES_PER_OBJECT; break;
+            case RenderMode::Indirect: bytes_per_object = lve::IndirectRenderSystem::FRAME_RING_BYTES_PER_OBJECT; break;
+            case RenderMode::PerObject:
+            case RenderMode::Secondary: return lve::LveRenderer::FRAME_RING_BUFFER_SIZE;
+        }
+        // headroom for the per-model indirect commands and alignment padding between allocations
+        const VkDeviceSize headroom = 1024 * 1024 + config.model_count * sizeof(VkDrawIndexedIndirectCommand);
+        return std::max(lve::LveRenderer::FRAME_RING_BUFFER_SIZE, config.object_count * bytes_per_object + headroom);
+    }
+
+    // objects on a square grid covering clip space, shrunk so they never overlap
+    std::vector<lve::LveGameObject> createScene(const std::vector<std::shared_ptr<lve::LveModel>>& models, uint32_t object_count)
+    {
+        const uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(object_count))));
+        const float cell = 1.8f / side;
+
+        std::vector<lve::LveGameObject> game_objects{};
+        game_objects.reserve(object_count);
+        for (uint32_t i = 0; i < object_count; i++)
+        {
+            auto game_obj = lve::LveGameObject::createGameObject();
+            game_obj.model_ = models[i % models.size()];
+            game_obj.transform_.translation = {-0.9f + cell * (i % side + 0.5f), -0.9f + cell * (i / side + 0.5f), 0.5f};
+            game_obj.transform_.scale = glm::vec3{cell * 0.5f};
+            game_obj.transform_.rotation = {0.001f * i, 0.002f * i, 0.0f};
+            game_objects.push_back(std::move(game_obj));
+        }
+        return game_objects;
+    }
+
+    // game_objects[i] becomes node i % depth of a chain, its transform is the local one relative to the node above;
+    // roots keep their grid placement, the nodes below hang off them in a row
+    std::vector<lve::LveSceneGraph::NodeId> createHierarchy(std::vector<lve::LveGameObject>& game_objects, uint32_t depth, lve::LveSceneGraph& scene_graph)
+    {
+        std::vector<lve::LveSceneGraph::NodeId> node_ids{};
+        node_ids.reserve(game_objects.size());
+        for (size_t i = 0; i < game_objects.size(); i++)
+        {
+            const bool is_root = i % depth == 0;
+            const auto node = scene_graph.createNode(is_root ? lve::LveSceneGraph::NO_NODE : node_ids.back());
+            if (!is_root)
+            {
+                auto& transform = game_objects[i].transform_;
+                transform.translation = {0.6f, 0.0f, 0.0f};
+                transform.scale = glm::vec3{0.8f};
+                transform.rotation = {};
+            }
+            scene_graph.editLocalTransform(node) = game_objects[i].transform_;
+            node_ids.push_back(node);
+        }
+        return node_ids;
+    }
+
+    int runBenchmark(const BenchConfig& config)
+    {
+        using clock = std::chrono::steady_clock;
+
+        if (!config.trace_path.empty())
+        {
+            lve::LveCpuProfiler::get().setEnabled(true);
+            lve::LveCpuProfiler::get().setThreadName("main");
+        }
+
+        lve::LveJobSystem job_system{config.worker_count};
+        lve::LveJobSystem* jobs = config.worker_count > 0 ? &job_system : nullptr;
+
+        lve::LveDevice lve_device{};
+        lve::LveRenderer lve_renderer{lve_device, VkExtent2D{config.width, config.height}, frameRingBufferSize(config)};
+        lve::SimpleRenderSystem simple_render_system{lve_device, lve_renderer.getSwapChainRenderPass(), jobs};
+        lve::IndirectRenderSystem indirect_render_system{lve_device, lve_renderer.getSwapChainRenderPass()};
+        const auto frustum = lve::LveFrustum::fromMatrix(glm::mat4{1.0f});   // no camera, objects are placed in clip space
+        lve::LveFrustumCuller frustum_culler{jobs};
+        lve::LveBvh bvh{};
+        std::vector<uint32_t> visible_objects{};
+        std::vector<lve::LveGameObject::id_t> visible_ids{};
+        std::vector<lve::LveEntity> visible_entities{};
+        const CpuCull cpu_cull = config.mode == RenderMode::Indirect ? CpuCull::Off : config.cpu_cull;
+
+        // geometry is decoded and deduplicated as jobs, creating the buffers stays on this thread
+        std::vector<lve::LveModel::Builder> builders(config.model_count);
+        job_system.parallelFor(builders.size(), 1, [&builders](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; i++)
+            {
+                builders[i] = buildSyntheticModel(static_cast<uint32_t>(i));
+            }
+        });
+        std::vector<std::shared_ptr<lve::LveModel>> models{};
+        for (const auto& builder : builders)
+        {
+            models.push_back(std::make_unique<lve::LveModel>(lve_device, builder));
+        }
+        lve_device.uploadQueue().wait(lve_device.uploadQueue().submit());
+
+        // every object spins, in a hierarchy only the second node of each chain does and carries the nodes below
+        // it, so propagate() skips the roots; one fixed step per frame keeps the per-frame work independent of the frame rate
+        auto game_objects = createScene(models, config.object_count);
+        lve::LveSceneGraph scene_graph{};
+        std::vector<lve::LveSceneGraph::NodeId> node_ids{};
+        if (config.hierarchy_depth > 0)
+        {
+            node_ids = createHierarchy(game_objects, config.hierarchy_depth, scene_graph);
+        }
+        std::vector<lve::SimulationComponent> simulations{};
+        for (size_t i = 0; i < game_objects.size(); i++)
+        {
+            simulations.push_back(lve::SimulationComponent::fromTransform(game_objects[i].transform_));
+            if (config.hierarchy_depth == 0 || i % config.hierarchy_depth == 1)
+            {
+                simulations.back().angular_velocity = {0.3f, 0.6f, 0.0f};
+            }
+        }
+        std::vector<uint32_t> synced_versions(node_ids.size(), 0);   // transform version last copied into the scene graph
+        lve::LveSimulation simulation{lve::LveSimulation::DEFAULT_TIMESTEP, 1, jobs};
+        lve::LveTransformStore transform_store{};
+        lve::LveRegistry registry{};
+        if (config.mode == RenderMode::Entities)
+        {
+            for (size_t i = 0; i < game_objects.size(); i++)
+            {
+                const lve::LveEntity entity = registry.create();
+                registry.emplace<lve::TransformComponent>(entity, game_objects[i].transform_);
+                registry.emplace<lve::RenderComponent>(entity, game_objects[i].model_, game_objects[i].color_);
+                registry.emplace<lve::SimulationComponent>(entity, simulations[i]);
+            }
+        }
+        std::unordered_map<lve::LveGameObject::id_t, uint32_t> object_indices{};
+        if (cpu_cull == CpuCull::Bvh)
+        {
+            for (uint32_t i = 0; i < game_objects.size(); i++)
+            {
+                bvh.insert(game_objects[i].getId(), lve::LveBvh::computeWorldBounds(game_objects[i]));
+                object_indices[game_objects[i].getId()] = i;
+            }
+        }
+
+        std::vector<double> frame_ms{};
+        std::vector<double> record_ms{};
+        std::vector<double> cpu_cull_ms{};
+        std::vector<double> simulation_ms{};
+        std::vector<double> transform_ms{};
+        std::vector<double> scene_graph_ms{};
+        uint64_t total_draw_calls = 0;
+        uint64_t total_visible_objects = 0;
+        uint64_t total_bvh_reinserts = 0;
+        uint64_t total_uploaded_objects = 0;
+        uint64_t total_model_binds_saved = 0;
+        uint64_t total_rebuilt_transforms = 0;
+        uint64_t total_rebuilt_nodes = 0;
+
+        const uint32_t total_frames = config.warmup_frames + config.frame_count;
+        auto& gpu_profiler = lve_renderer.getGpuProfiler();
+        gpu_profiler.setHistoryLength(total_frames);
+        const auto bench_start = clock::now();
+        for (uint32_t frame = 0; frame < total_frames; frame++)
+        {
+            const bool measured = frame >= config.warmup_frames;
+            const auto frame_start = clock::now();
+            LVE_CPU_ZONE("Frame");
+
+            auto command_buffer = lve_renderer.beginFrame();
+
+            const auto simulation_start = clock::now();
+            if (config.mode == RenderMode::Entities)
+            {
+                simulation.update(registry, simulation.getTimestep());
+            }
+            else
+            {
+                simulation.update(simulations, game_objects, simulation.getTimestep());
+            }
+
+            // one batched rebuild of the moved matrices, before anything reads them
+            const auto transform_start = clock::now();
+            const size_t rebuilt_transforms = config.mode == RenderMode::Entities ? transform_store.updateDirtyMatrices(registry, jobs) : transform_store.updateDirtyMatrices(game_objects, jobs);
+
+            // moved local transforms mark their nodes dirty, propagate() rebuilds those and their subtrees level by level
+            const auto scene_graph_start = clock::now();
+            size_t rebuilt_nodes = 0;
+            if (config.hierarchy_depth > 0)
+            {
+                for (size_t i = 0; i < game_objects.size(); i++)
+                {
+                    const auto& transform = game_objects[i].transform_;
+                    if (transform.getVersion() != synced_versions[i])
+                    {
+                        scene_graph.editLocalTransform(node_ids[i]) = transform;   // copies the cached matrix as well
+                        synced_versions[i] = transform.getVersion();
+                    }
+                }
+                if (jobs != nullptr)
+                {
+                    scene_graph.propagate([jobs](size_t count, const auto& function) { jobs->parallelFor(count, 1024, function); });
+                }
+                else
+                {
+                    scene_graph.propagate();
+                }
+                const auto& changed = scene_graph.getChangedFlags();
+                rebuilt_nodes = std::count(changed.begin(), changed.end(), 1);
+            }
+
+            const auto cull_start = clock::now();
+            uint32_t bvh_reinserts = 0;
+            if (cpu_cull == CpuCull::Linear && config.mode == RenderMode::Entities)
+            {
+                frustum_culler.cull(frustum, registry, visible_entities);
+            }
+            else if (cpu_cull == CpuCull::Linear)
+            {
+                frustum_culler.cull(frustum, game_objects, visible_objects);
+            }
+            else if (cpu_cull == CpuCull::Bvh)
+            {
+                // every object spins, so every leaf is refit; only the ones leaving their fat box are reinserted
+                for (auto& game_obj : game_objects)
+                {
+                    bvh_reinserts += bvh.move(game_obj.getId(), lve::LveBvh::computeWorldBounds(game_obj));
+                }
+                visible_ids.clear();
+                bvh.queryFrustum(frustum, visible_ids);
+                visible_objects.clear();
+                for (auto id : visible_ids)
+                {
+                    visible_objects.push_back(object_indices[id]);
+                }
+            }
+            const auto cull_end = clock::now();   // recording starts here, cpu_record_ms does not include the cull
+            const std::vector<uint32_t>* visible = cpu_cull != CpuCull::Off ? &visible_objects : nullptr;
+            if (config.mode == RenderMode::Indirect)
+            {
+                lve::LveGpuProfiler::ScopedZone zone{gpu_profiler, command_buffer, "Cull"};
+                indirect_render_system.cullGameObjects(command_buffer, lve_renderer.getFrameIndex(), lve_renderer.getFrameRingBuffer(), game_objects, frustum);
+            }
+            if (config.mode == RenderMode::Secondary)
+            {
+                // only vkCmdExecuteCommands may be recorded inside this pass, so the zone has to enclose the whole pass
+                lve::LveGpuProfiler::ScopedZone zone{gpu_profiler, command_buffer, "Render"};
+                lve_renderer.beginSwapChainRenderPass(command_buffer, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+                simple_render_system.renderGameObjectsSecondary(command_buffer, lve_renderer, game_objects, visible);
+                lve_renderer.endSwapChainRenderPass(command_buffer);
+            }
+            else
+            {
+                lve_renderer.beginSwapChainRenderPass(command_buffer);
+                {
+                    lve::LveGpuProfiler::ScopedZone zone{gpu_profiler, command_buffer, "Render"};
+                    switch (config.mode)
+                    {
+                        case RenderMode::Instanced:
+                            if (config.hierarchy_depth > 0)
+                            {
+                                simple_render_system.renderSceneGraphInstanced(command_buffer, lve_renderer.getFrameRingBuffer(), scene_graph, game_objects, node_ids);
+                            }
+                            else
+                            {
+                                simple_render_system.renderGameObjectsInstanced(command_buffer, lve_renderer.getFrameRingBuffer(), game_objects, visible);
+                            }
+                            break;
+                        case RenderMode::PerObject:
+                            simple_render_system.renderGameObjects(command_buffer, game_objects, visible);
+                            break;
+                        case RenderMode::Indirect:
+                            indirect_render_system.renderGameObjects(command_buffer);
+                            break;
+                        case RenderMode::Entities:
+                            simple_render_system.renderEntitiesInstanced(command_buffer, lve_renderer.getFrameRingBuffer(), registry, cpu_cull != CpuCull::Off ? &visible_entities : nullptr);
+                            break;
+                        case RenderMode::Secondary:
+                            break;   // recorded above
+                    }
+                }
+                lve_renderer.endSwapChainRenderPass(command_buffer);
+            }
+            const auto record_end = clock::now();
+
+            lve_renderer.endFrame();
+            const auto frame_end = clock::now();
+
+            if (measured)
+            {
+                frame_ms.push_back(std::chrono::duration<double, std::milli>(frame_end - frame_start).count());
+                record_ms.push_back(std::chrono::duration<double, std::milli>(record_end - cull_end).count());
+                simulation_ms.push_back(std::chrono::duration<double, std::milli>(transform_start - simulation_start).count());
+                transform_ms.push_back(std::chrono::duration<double, std::milli>(scene_graph_start - transform_start).count());
+                total_rebuilt_transforms += rebuilt_transforms;
+                if (config.hierarchy_depth > 0)
+                {
+                    scene_graph_ms.push_back(std::chrono::duration<double, std::milli>(cull_start - scene_graph_start).count());
+                    total_rebuilt_nodes += rebuilt_nodes;
+                }
+                if (cpu_cull != CpuCull::Off)
+                {
+                    cpu_cull_ms.push_back(std::chrono::duration<double, std::milli>(cull_end - cull_start).count());
+                    total_visible_objects += config.mode == RenderMode::Entities ? visible_entities.size() : visible_objects.size();
+                    total_bvh_reinserts += bvh_reinserts;
+                }
+                if (config.mode == RenderMode::Indirect)
+                {
+                    total_draw_calls += indirect_render_system.getDrawCallCount();
+                    total_uploaded_objects += indirect_render_system.getUploadedObjectCount();
+                }
+                else
+                {
+                    total_draw_calls += simple_render_system.getDrawCallCount();
+                    total_model_binds_saved += simple_render_system.getBindStats().modelBindsSaved();
+                }
+            }
+        }
+        vkDeviceWaitIdle(lve_device.device());
+        const double total_seconds = std::chrono::duration<double>(clock::now() - bench_start).count();
+
+        // profiler frame numbers start at 0 with the first beginFrame(), headless frames are never skipped
+        gpu_profiler.collectPendingResults();
+        std::vector<double> gpu_ms{};
+        std::vector<double> gpu_render_ms{};
+        std::vector<double> gpu_cull_ms{};
+        for (const auto& result : gpu_profiler.getHistory())
+        {
+            if (result.frame_number < config.warmup_frames)
+            {
+                continue;
+            }
+            gpu_ms.push_back(result.frame_milliseconds);
+            for (const auto& zone : result.zones)
+            {
+                if (std::strcmp(zone.name, "Render") == 0)
+                {
+                    gpu_render_ms.push_back(zone.milliseconds);
+                }
+                else if (std::strcmp(zone.name, "Cull") == 0)
+                {
+                    gpu_cull_ms.push_back(zone.milliseconds);
+                }
+            }
+        }
+
+        std::ostringstream json{};
+        json << "{\n";
+        json << "    \"device\": ";
+        writeString(json, lve_device.properties.deviceName);
+        json << ",\n";
+        json << "    \"objects\": " << config.object_count << ",\n";
+        json << "    \"models\": " << config.model_count << ",\n";
+        json << "    \"mode\": \"" << renderModeName(config.mode) << "\",\n";
+        json << "    \"transform_kernel\": \"" << lve::LveTransformStore::getKernelName() << "\",\n";
+        json << "    \"job_workers\": " << config.worker_count << ",\n";
+        const auto registry_stats = lve_device.pipelineRegistry().getStats();
+        json << "    \"pipeline_registry\": {\"pipelines\": " << registry_stats.pipelines << ", \"pipeline_layouts\": " << registry_stats.pipeline_layouts
+             << ", \"shader_modules\": " << registry_stats.shader_modules << ", \"requests\": " << registry_stats.request_count << "},\n";
+        switch (cpu_cull)
+        {
+            case CpuCull::Off: json << "    \"cpu_cull\": null,\n"; break;
+            case CpuCull::Linear: json << "    \"cpu_cull\": \"" << lve::LveFrustumCuller::getKernelName() << "\",\n"; break;
+            case CpuCull::Bvh: json << "    \"cpu_cull\": \"bvh\",\n"; break;
+        }
+        json << "    \"frames\": " << config.frame_count << ",\n";
+        json << "    \"warmup_frames\": " << config.warmup_frames << ",\n";
+        json << "    \"extent\": [" << config.width << ", " << config.height << "],\n";
+        json << "    \"total_seconds\": " << total_seconds << ",\n";
+        json << "    \"draw_calls_per_frame\": " << (total_draw_calls / config.frame_count) << ",\n";
+        json << "    \"model_binds_saved_per_frame\": " << (total_model_binds_saved / config.frame_count) << ",\n";
+        json << "    \"visible_objects_per_frame\": " << (cpu_cull != CpuCull::Off ? total_visible_objects / config.frame_count : config.object_count) << ",\n";
+        json << "    \"bvh_reinserts_per_frame\": " << (total_bvh_reinserts / config.frame_count) << ",\n";
+        json << "    \"uploaded_objects_per_frame\": " << (total_uploaded_objects / config.frame_count) << ",\n";
+        json << "    \"rebuilt_transforms_per_frame\": " << (total_rebuilt_transforms / config.frame_count) << ",\n";
+        if (config.hierarchy_depth > 0)
+        {
+            json << "    \"scene_graph\": {\"depth\": " << config.hierarchy_depth << ", \"nodes\": " << scene_graph.size()
+                 << ", \"rebuilt_nodes_per_frame\": " << (total_rebuilt_nodes / config.frame_count) << "},\n";
+        }
+        else
+        {
+            json << "    \"scene_graph\": null,\n";
+        }
+        writeSummary(json, "cpu_frame_ms", summarize(frame_ms));
+        json << ",\n";
+        writeSummary(json, "cpu_record_ms", summarize(record_ms));
+        json << ",\n";
+        writeSummary(json, "cpu_cull_ms", summarize(cpu_cull_ms), !cpu_cull_ms.empty());
+        json << ",\n";
+        writeSummary(json, "cpu_simulation_ms", summarize(simulation_ms));
+        json << ",\n";
+        writeSummary(json, "cpu_transform_ms", summarize(transform_ms));
+        json << ",\n";
+        writeSummary(json, "cpu_scene_graph_ms", summarize(scene_graph_ms), !scene_graph_ms.empty());
+        json << ",\n";
+        writeSummary(json, "gpu_frame_ms", summarize(gpu_ms), !gpu_ms.empty());
+        json << ",\n";
+        writeSummary(json, "gpu_render_ms", summarize(gpu_render_ms), !gpu_render_ms.empty());
+        json << ",\n";
+        writeSummary(json, "gpu_cull_ms", summarize(gpu_cull_ms), !gpu_cull_ms.empty());
+        json << "\n}\n";
+
+        std::cout << json.str();
+        if (!config.output_path.empty())
+        {
+            std::ofstream file{config.output_path};
+            file << json.str();
+        }
+        if (!config.trace_path.empty())
+        {
+            lve::LveCpuProfiler::get().saveChromeTrace(config.trace_path);
+        }
+
+        return EXIT_SUCCESS;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        return runBenchmark(parseArgs(argc, argv));
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
@@ -1,5 +1,10 @@
 #include "first_app.hpp"
 #include "simple_render_system.hpp"
+#include "lve_frustum_culler.hpp"
+#include "lve_cpu_profiler.hpp"
+#include "lve_shader_hot_reload.hpp"
+#include "lve_simulation.hpp"
+#include "lve_transform_store.hpp"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -8,6 +13,7 @@
 
 #include <stdexcept>
 #include <array>
+#include <chrono>
 
 namespace lve
 {
@@ -20,15 +26,40 @@ namespace lve
 
     void FirstApp::run()
     {
-        SimpleRenderSystem simple_render_system{lve_device_, lve_renderer_.getSwapChainRenderPass()};
+        LVE_CPU_ZONE("FirstApp::run");
+        LveShaderHotReload shader_hot_reload{pipeline_compiler_};   // edit a shader in shaders/ while running to rebuild its pipelines
+        SimpleRenderSystem simple_render_system{lve_device_, lve_renderer_.getSwapChainRenderPass(), &job_system_, &pipeline_compiler_, &shader_hot_reload};
+        LveFrustumCuller frustum_culler{&job_system_};
+        std::vector<LveEntity> visible_entities{};
+        const auto frustum = LveFrustum::fromMatrix(glm::mat4{1.0f});   // no camera yet, objects are in clip space
+        LveSimulation simulation{LveSimulation::DEFAULT_TIMESTEP, 8, &job_system_};
+        LveTransformStore transform_store{};
+        auto previous_time = std::chrono::steady_clock::now();
         while (!lve_window_.shouldClose())
         {
-            glfwPollEvents();
+            LVE_CPU_ZONE("Frame");
+            {
+                LVE_CPU_ZONE("glfwPollEvents");
+                glfwPollEvents();
+            }
+
+            // fixed steps for the time that passed, then the rendered transforms are interpolated between the last two
+            const auto current_time = std::chrono::steady_clock::now();
+            simulation.update(registry_, std::chrono::duration<double>(current_time - previous_time).count());
+            previous_time = current_time;
+            // moved objects get their matrices in one batch, culling and rendering only read the cached ones
+            transform_store.updateDirtyMatrices(registry_, &job_system_);
 
             if (auto command_buffer = lve_renderer_.beginFrame())
             {
+                shader_hot_reload.beginFrame(lve_renderer_.getFrameIndex());
+                frustum_culler.cull(frustum, registry_, visible_entities);
+
                 lve_renderer_.beginSwapChainRenderPass(command_buffer);
-                simple_render_system.renderGameObjects(command_buffer, game_objects_);
+                {
+                    LveGpuProfiler::ScopedZone zone{lve_renderer_.getGpuProfiler(), command_buffer, "SimpleRenderSystem"};
+                    simple_render_system.renderEntitiesInstanced(command_buffer, lve_renderer_.getFrameRingBuffer(), registry_, &visible_entities);
+                }
                 lve_renderer_.endSwapChainRenderPass(command_buffer);
                 lve_renderer_.endFrame();
             }
@@ -97,18 +128,21 @@ std::unique_ptr<LveModel> createCubeModel(LveDevice& device, glm::vec3 offset)
         v.position += offset;
     }
 
-    return std::make_unique<LveModel>(device, vertices);
+    LveModel::Builder model_builder{};
+    model_builder.loadTriangleList(vertices);   // 36 triangle-list vertices -> 24 unique vertices + 36 indices
+    return std::make_unique<LveModel>(device, model_builder);
 }
 
     void FirstApp::loadGameObjects()
     {
         std::shared_ptr<LveModel> lve_model = createCubeModel(lve_device_, {0.0f, 0.0f, 0.0f});
 
-        auto cube = LveGameObject::createGameObject();
-        cube.model_ = lve_model;
-        cube.transform_.translation = {0.0f, 0.0f, 0.5f};
-        cube.transform_.scale = {-.5f, 0.5f, 0.5f};
-
-        game_objects_.push_back(std::move(cube));
+        const LveEntity cube = registry_.create();
+        auto& transform = registry_.emplace<TransformComponent>(cube);
+        transform.translation = {0.0f, 0.0f, 0.5f};
+        transform.scale = {-.5f, 0.5f, 0.5f};
+        registry_.emplace<RenderComponent>(cube, lve_model);
+        auto& simulation = registry_.emplace<SimulationComponent>(cube, SimulationComponent::fromTransform(transform));
+        simulation.angular_velocity = {0.3f, 0.6f, 0.0f};
     }
 }
\ No newline at end of file
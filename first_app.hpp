@@ -2,11 +2,13 @@
 
 #include "lve_device.hpp"
 #include "lve_game_object.hpp"
+#include "lve_job_system.hpp"
+#include "lve_pipeline_compiler.hpp"
+#include "lve_registry.hpp"
 #include "lve_window.hpp"
 #include "lve_renderer.hpp"
 
 #include <memory>
-#include <vector>
 
 namespace lve
 {
@@ -28,10 +30,12 @@ namespace lve
         private:
             void loadGameObjects();
 
+            LveJobSystem job_system_{};   // first member, so the workers outlive everything submitting jobs
             LveWindow lve_window_{WIDTH, HEIGHT, "Little Vulkan Engine (lve) project"};
             LveDevice lve_device_{lve_window_};
+            LvePipelineCompiler pipeline_compiler_{lve_device_};   // after the device, joined before it is destroyed
             LveRenderer lve_renderer_{lve_window_, lve_device_};
 
-            std::vector<LveGameObject> game_objects_;
+            LveRegistry registry_;   // entities with TransformComponent + RenderComponent are drawn
     };
 }
\ No newline at end of file
@@ -0,0 +1,398 @@
+#include "indirect_render_system.hpp"
+#include "lve_cpu_profiler.hpp"
+#include "lve_swap_chain.hpp"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace lve
+{
+    // std430 layout of ObjectData in indirect_cull.comp and indirect_shader.vert
+    struct IndirectObjectData
+    {
+        glm::mat4 transform{1.0f};
+        glm::vec4 color{};
+        glm::vec4 bounding_sphere{};
+        uint32_t model_index;
+        uint32_t instance_base;
+        uint32_t padding[2];
+    };
+    static_assert(sizeof(IndirectObjectData) == 112, "IndirectObjectData must match the std430 layout of the shaders");
+    static_assert(sizeof(IndirectObjectData) + sizeof(uint32_t) == IndirectRenderSystem::FRAME_RING_BYTES_PER_OBJECT, "FRAME_RING_BYTES_PER_OBJECT has to match IndirectObjectData");
+
+    struct IndirectCullPushConstantData
+    {
+        glm::vec4 frustum_planes[6];
+        uint32_t object_count;
+    };
+
+    struct IndirectDrawPushConstantData
+    {
+        uint32_t instance_base;
+    };
+
+    constexpr uint32_t CULL_WORKGROUP_SIZE = 64;   // local_size_x of indirect_cull.comp
+
+    IndirectRenderSystem::IndirectRenderSystem(LveDevice& device, VkRenderPass render_pass) : lve_device_(device)
+    {
+        createDescriptorSetLayout();
+        createDescriptorSets();
+        createPipelineLayouts();
+        createPipelines(render_pass);
+    }
+
+    IndirectRenderSystem::~IndirectRenderSystem()
+    {
+        vkDestroyDescriptorPool(lve_device_.device(), descriptor_pool_, nullptr);   // frees the sets as well
+        vkDestroyDescriptorSetLayout(lve_device_.device(), descriptor_set_layout_, nullptr);
+        if (object_buffer_ != VK_NULL_HANDLE)
+        {
+            lve_device_.destroyBuffer(object_buffer_, object_allocation_);
+        }
+    }
+
+    void IndirectRenderSystem::createDescriptorSetLayout()
+    {
+        // 0: object data, 1: draw commands, 2: visible object indices
+        std::array<VkDescriptorSetLayoutBinding, 3> bindings{};
+        for (uint32_t i = 0; i < bindings.size(); i++)
+        {
+            bindings[i].binding = i;
+            bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            bindings[i].descriptorCount = 1;
+            bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT;
+        }
+        bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        VkDescriptorSetLayoutCreateInfo info{};
+        info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        info.bindingCount = static_cast<uint32_t>(bindings.size());
+        info.pBindings = bindings.data();
+
+        if (vkCreateDescriptorSetLayout(lve_device_.device(), &info, nullptr, &descriptor_set_layout_) != VK_SUCCESS)
+        {
+            throw std::runtime_error("IndirectRenderSystem::createDescriptorSetLayout(); could not create descriptor set layout");
+        }
+    }
+
+    void IndirectRenderSystem::createDescriptorSets()
+    {
+        constexpr uint32_t set_count = LveSwapChain::MAX_FRAMES_IN_FLIGHT;
+
+        VkDescriptorPoolSize pool_size{};
+        pool_size.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        pool_size.descriptorCount = 3 * set_count;
+
+        VkDescriptorPoolCreateInfo pool_info{};
+        pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        pool_info.maxSets = set_count;
+        pool_info.poolSizeCount = 1;
+        pool_info.pPoolSizes = &pool_size;
+
+        if (vkCreateDescriptorPool(lve_device_.device(), &pool_info, nullptr, &descriptor_pool_) != VK_SUCCESS)
+        {
+            throw std::runtime_error("IndirectRenderSystem::createDescriptorSets(); could not create descriptor pool");
+        }
+
+        std::vector<VkDescriptorSetLayout> layouts(set_count, descriptor_set_layout_);
+        VkDescriptorSetAllocateInfo alloc_info{};
+        alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        alloc_info.descriptorPool = descriptor_pool_;
+        alloc_info.descriptorSetCount = set_count;
+        alloc_info.pSetLayouts = layouts.data();
+
+        descriptor_sets_.resize(set_count);
+        if (vkAllocateDescriptorSets(lve_device_.device(), &alloc_info, descriptor_sets_.data()) != VK_SUCCESS)
+        {
+            throw std::runtime_error("IndirectRenderSystem::createDescriptorSets(); could not allocate descriptor sets");
+        }
+    }
+
+    void IndirectRenderSystem::createPipelineLayouts()
+    {
+        VkPushConstantRange cull_push_constant_range
+        {
+            .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+            .offset = 0,
+            .size = sizeof(IndirectCullPushConstantData)
+        };
+        cull_pipeline_layout_ = lve_device_.pipelineRegistry().getPipelineLayout({descriptor_set_layout_}, {cull_push_constant_range});
+
+        VkPushConstantRange draw_push_constant_range
+        {
+            .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+            .offset = 0,
+            .size = sizeof(IndirectDrawPushConstantData)
+        };
+        draw_pipeline_layout_ = lve_device_.pipelineRegistry().getPipelineLayout({descriptor_set_layout_}, {draw_push_constant_range});
+    }
+
+    void IndirectRenderSystem::createPipelines(VkRenderPass render_pass)
+    {
+        assert(cull_pipeline_layout_ != nullptr && draw_pipeline_layout_ != nullptr && "Cannot create pipelines before pipeline layouts");
+
+        cull_pipeline_ = lve_device_.pipelineRegistry().getComputePipeline("shaders/indirect_cull.comp.spv", cull_pipeline_layout_->get());
+
+        // the fragment stage is the same as for the instanced path, the registry shares its shader module
+        PipelineConfigInfo pipeline_config_info{};
+        LvePipeline::default_pipeline_config_info_(pipeline_config_info);
+        pipeline_config_info.render_pass = render_pass;
+        pipeline_config_info.pipeline_layout = draw_pipeline_layout_->get();
+        draw_pipeline_ = lve_device_.pipelineRegistry().getGraphicsPipeline("shaders/indirect_shader.vert.spv", "shaders/instanced_shader.frag.spv", pipeline_config_info);
+    }
+
+    void IndirectRenderSystem::cullGameObjects(VkCommandBuffer command_buffer, int frame_index, LveFrameRingBuffer& frame_ring_buffer, std::vector<LveGameObject>& game_objects, const LveFrustum& frustum)
+    {
+        LVE_CPU_ZONE("IndirectRenderSystem::cullGameObjects");
+        model_draws_.clear();
+        model_ids_.clear();
+        current_descriptor_set_ = VK_NULL_HANDLE;
+
+        // assign every drawable object to its model and count objects per model
+        object_models_.resize(game_objects.size());
+        uint32_t object_count = 0;
+        for (size_t i = 0; i < game_objects.size(); i++)
+        {
+            auto& game_obj = game_objects[i];
+            if (!game_obj.model_->isUploaded())
+            {
+                object_models_[i] = UINT32_MAX;   // geometry still in flight on the upload queue
+                continue;
+            }
+
+            auto [it, inserted] = model_ids_.try_emplace(game_obj.model_.get(), static_cast<uint32_t>(model_draws_.size()));
+            if (inserted)
+            {
+                model_draws_.push_back({game_obj.model_.get(), 0, 0});
+            }
+            object_models_[i] = it->second;
+            model_draws_[it->second].object_count++;
+            object_count++;
+        }
+        if (object_count == 0)
+        {
+            return;
+        }
+
+        // every model gets room for all of its objects, culling decides how many slots are used
+        uint32_t instance_total = 0;
+        for (auto& model_draw : model_draws_)
+        {
+            model_draw.instance_base = instance_total;
+            instance_total += model_draw.object_count;
+        }
+
+        uploadObjects(command_buffer, frame_ring_buffer, game_objects, object_count);
+
+        commands_range_ = frame_ring_buffer.allocate(model_draws_.size() * sizeof(VkDrawIndexedIndirectCommand));
+        const auto visible_range = frame_ring_buffer.allocate(instance_total * sizeof(uint32_t));
+
+        // instance counts start at zero and are incremented by the culling shader; non-indexed models use the
+        // VkDrawIndirectCommand layout, which shares the offset of instanceCount
+        auto* commands = static_cast<VkDrawIndexedIndirectCommand*>(commands_range_.mapped);
+        for (size_t i = 0; i < model_draws_.size(); i++)
+        {
+            const LveModel* model = model_draws_[i].model;
+            commands[i] = {};
+            commands[i].indexCount = model->hasIndexBuffer() ? model->getIndexCount() : model->getVertexCount();
+        }
+
+        current_descriptor_set_ = descriptor_sets_[frame_index];
+        std::array<VkDescriptorBufferInfo, 3> buffer_infos
+        {{
+            {object_buffer_, 0, object_count * sizeof(IndirectObjectData)},
+            {commands_range_.buffer, commands_range_.offset, commands_range_.size},
+            {visible_range.buffer, visible_range.offset, visible_range.size}
+        }};
+        std::array<VkWriteDescriptorSet, 3> writes{};
+        for (uint32_t i = 0; i < writes.size(); i++)
+        {
+            writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writes[i].dstSet = current_descriptor_set_;
+            writes[i].dstBinding = i;
+            writes[i].descriptorCount = 1;
+            writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            writes[i].pBufferInfo = &buffer_infos[i];
+        }
+        vkUpdateDescriptorSets(lve_device_.device(), static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+
+        IndirectCullPushConstantData push{};
+        for (size_t i = 0; i < frustum.planes.size(); i++)
+        {
+            push.frustum_planes[i] = frustum.planes[i];
+        }
+        push.object_count = object_count;
+
+        cull_pipeline_->bind(command_buffer);
+        vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, cull_pipeline_layout_->get(), 0, 1, &current_descriptor_set_, 0, nullptr);
+        vkCmdPushConstants(command_buffer, cull_pipeline_layout_->get(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(IndirectCullPushConstantData), &push);
+        vkCmdDispatch(command_buffer, (object_count + CULL_WORKGROUP_SIZE - 1) / CULL_WORKGROUP_SIZE, 1, 1);
+
+        // draw commands and visible indices must be written before the indirect draws and vertex shaders read them
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(
+            command_buffer,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+            0,
+            1, &barrier,
+            0, nullptr,
+            0, nullptr
+        );
+    }
+
+    void IndirectRenderSystem::growObjectBuffer(uint32_t object_count)
+    {
+        // frames in flight may still read the old buffer, growing only happens while the scene grows
+        vkDeviceWaitIdle(lve_device_.device());
+        if (object_buffer_ != VK_NULL_HANDLE)
+        {
+            lve_device_.destroyBuffer(object_buffer_, object_allocation_);
+        }
+
+        object_capacity_ = std::max(object_count, object_capacity_ * 2);
+        lve_device_.createBuffer(
+            object_capacity_ * sizeof(IndirectObjectData),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            object_buffer_,
+            object_allocation_
+        );
+
+        // the new buffer holds nothing yet, every object has to be uploaded again
+        uploaded_ids_.clear();
+    }
+
+    void IndirectRenderSystem::uploadObjects(VkCommandBuffer command_buffer, LveFrameRingBuffer& frame_ring_buffer, std::vector<LveGameObject>& game_objects, uint32_t object_count)
+    {
+        if (object_count > object_capacity_)
+        {
+            growObjectBuffer(object_count);
+        }
+
+        // compare against the shadow copy of the device buffer, the transform by version and the rest by value;
+        // the object id guards against another object (with its own version counter) moving into a slot
+        constexpr auto NO_OBJECT = std::numeric_limits<LveGameObject::id_t>::max();
+        uploaded_objects_.resize(object_count);
+        uploaded_ids_.resize(object_count, NO_OBJECT);
+        uploaded_versions_.resize(object_count, 0);
+        upload_regions_.clear();
+        uploaded_object_count_ = 0;
+
+        uint32_t object_index = 0;
+        for (size_t i = 0; i < game_objects.size(); i++)
+        {
+            if (object_models_[i] == UINT32_MAX)
+            {
+                continue;
+            }
+
+            auto& game_obj = game_objects[i];
+            const ModelDraw& model_draw = model_draws_[object_models_[i]];
+            const glm::mat4& transform = game_obj.transform_.mat4();
+            const glm::vec4 color{game_obj.color_, 1.0f};
+            const glm::vec4 bounding_sphere = model_draw.model->getBoundingSphere();
+
+            IndirectObjectData& object = uploaded_objects_[object_index];
+            const bool changed = uploaded_ids_[object_index] != game_obj.getId() ||
+                uploaded_versions_[object_index] != game_obj.transform_.getVersion() ||
+                !(object.color == color) || !(object.bounding_sphere == bounding_sphere) ||
+                object.model_index != object_models_[i] || object.instance_base != model_draw.instance_base;
+            if (changed)
+            {
+                object.transform = transform;
+                object.color = color;
+                object.bounding_sphere = bounding_sphere;
+                object.model_index = object_models_[i];
+                object.instance_base = model_draw.instance_base;
+                uploaded_ids_[object_index] = game_obj.getId();
+                uploaded_versions_[object_index] = game_obj.transform_.getVersion();
+
+                // runs of changed objects become one copy region, srcOffset is relative to the staging range for now
+                const VkDeviceSize offset = object_index * sizeof(IndirectObjectData);
+                if (!upload_regions_.empty() && upload_regions_.back().dstOffset + upload_regions_.back().size == offset)
+                {
+                    upload_regions_.back().size += sizeof(IndirectObjectData);
+                }
+                else
+                {
+                    upload_regions_.push_back({uploaded_object_count_ * sizeof(IndirectObjectData), offset, sizeof(IndirectObjectData)});
+                }
+                uploaded_object_count_++;
+            }
+            object_index++;
+        }
+        if (upload_regions_.empty())
+        {
+            return;
+        }
+
+        const auto staging = frame_ring_buffer.allocate(uploaded_object_count_ * sizeof(IndirectObjectData));
+        for (auto& region : upload_regions_)
+        {
+            std::memcpy(static_cast<char*>(staging.mapped) + region.srcOffset, reinterpret_cast<const char*>(uploaded_objects_.data()) + region.dstOffset, region.size);
+            region.srcOffset += staging.offset;
+        }
+
+        // the previous frame's culling and vertex shaders may still read the ranges about to be overwritten
+        vkCmdPipelineBarrier(
+            command_buffer,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            0,
+            0, nullptr,
+            0, nullptr,
+            0, nullptr
+        );
+
+        vkCmdCopyBuffer(command_buffer, staging.buffer, object_buffer_, static_cast<uint32_t>(upload_regions_.size()), upload_regions_.data());
+
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(
+            command_buffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+            0,
+            1, &barrier,
+            0, nullptr,
+            0, nullptr
+        );
+    }
+
+    void IndirectRenderSystem::renderGameObjects(VkCommandBuffer command_buffer)
+    {
+        LVE_CPU_ZONE("IndirectRenderSystem::renderGameObjects");
+        draw_call_count_ = 0;
+        if (current_descriptor_set_ == VK_NULL_HANDLE)
+        {
+            return;   // nothing was culled this frame
+        }
+
+        draw_pipeline_->bind(command_buffer);
+        vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, draw_pipeline_layout_->get(), 0, 1, &current_descriptor_set_, 0, nullptr);
+
+        for (size_t i = 0; i < model_draws_.size(); i++)
+        {
+            const IndirectDrawPushConstantData push{model_draws_[i].instance_base};
+            vkCmdPushConstants(command_buffer, draw_pipeline_layout_->get(), VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(IndirectDrawPushConstantData), &push);
+
+            model_draws_[i].model->bind(command_buffer);
+            model_draws_[i].model->drawIndirect(command_buffer, commands_range_.buffer, commands_range_.offset + i * sizeof(VkDrawIndexedIndirectCommand));
+            draw_call_count_++;
+        }
+    }
+}
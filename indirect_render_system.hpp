@@ -0,0 +1,98 @@
+#pragma once
+
+#include "lve_device.hpp"
+#include "lve_frame_ring_buffer.hpp"
+#include "lve_frustum.hpp"
+#include "lve_game_object.hpp"
+#include "lve_pipeline.hpp"
+#include "lve_pipeline_registry.hpp"
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace lve
+{
+    struct IndirectObjectData;
+
+    /**
+        GPU driven path: object transforms and bounds are streamed into a storage buffer, a compute pass
+        frustum culls them and fills one indirect draw command per model, so recording the draws costs the
+        same for 100 or 100000 objects. Call cullGameObjects() before the render pass and
+        renderGameObjects() inside it, with the same command buffer.
+        Object data stays in a device local buffer, each frame only the runs of objects whose transform,
+        color or model changed are copied into it.
+    */
+    class IndirectRenderSystem
+    {
+        public:
+            // frame ring buffer bytes per object at most: staged object data plus its visible instance index
+            static constexpr VkDeviceSize FRAME_RING_BYTES_PER_OBJECT = 112 + sizeof(uint32_t);
+
+            IndirectRenderSystem(LveDevice& device, VkRenderPass render_pass);
+            ~IndirectRenderSystem();
+
+            // deleting copy operator and copy constructor
+            IndirectRenderSystem(const IndirectRenderSystem&) = delete;
+            IndirectRenderSystem &operator=(const IndirectRenderSystem&) = delete;
+
+            // outside of a render pass: writes object data into frame_ring_buffer and records the culling dispatch
+            void cullGameObjects(VkCommandBuffer command_buffer, int frame_index, LveFrameRingBuffer& frame_ring_buffer, std::vector<LveGameObject>& game_objects, const LveFrustum& frustum);
+
+            // inside the render pass: one indirect draw per model, instance counts come from the culling pass
+            void renderGameObjects(VkCommandBuffer command_buffer);
+
+            // number of draw commands recorded by the last renderGameObjects() call
+            uint32_t getDrawCallCount() const { return draw_call_count_; }
+
+            // objects and copy regions uploaded by the last cullGameObjects() call
+            uint32_t getUploadedObjectCount() const { return uploaded_object_count_; }
+            uint32_t getUploadRegionCount() const { return static_cast<uint32_t>(upload_regions_.size()); }
+
+        private:
+            struct ModelDraw
+            {
+                LveModel* model;
+                uint32_t instance_base;   // first slot of the model's visible instances
+                uint32_t object_count;
+            };
+
+            void createDescriptorSetLayout();
+            void createDescriptorSets();
+            void createPipelineLayouts();
+            void createPipelines(VkRenderPass render_pass);
+            void growObjectBuffer(uint32_t object_count);
+            void uploadObjects(VkCommandBuffer command_buffer, LveFrameRingBuffer& frame_ring_buffer, std::vector<LveGameObject>& game_objects, uint32_t object_count);
+
+            LveDevice& lve_device_;
+
+            VkDescriptorSetLayout descriptor_set_layout_;
+            VkDescriptorPool descriptor_pool_;
+            std::vector<VkDescriptorSet> descriptor_sets_;   // one per frame in flight, rewritten every frame
+
+            std::shared_ptr<LvePipelineLayout> cull_pipeline_layout_;
+            std::shared_ptr<LvePipelineLayout> draw_pipeline_layout_;
+            std::shared_ptr<LvePipeline> cull_pipeline_;
+            std::shared_ptr<LvePipeline> draw_pipeline_;
+
+            // state handed from cullGameObjects() to renderGameObjects()
+            std::vector<ModelDraw> model_draws_;
+            std::unordered_map<LveModel*, uint32_t> model_ids_;
+            std::vector<uint32_t> object_models_;
+
+            VkBuffer object_buffer_ = VK_NULL_HANDLE;
+            LveAllocation object_allocation_{};
+            uint32_t object_capacity_ = 0;
+
+            // shadow copy of object_buffer_ plus what each slot was built from
+            std::vector<IndirectObjectData> uploaded_objects_;
+            std::vector<LveGameObject::id_t> uploaded_ids_;
+            std::vector<uint32_t> uploaded_versions_;
+            std::vector<VkBufferCopy> upload_regions_;
+            uint32_t uploaded_object_count_ = 0;
+            VkDescriptorSet current_descriptor_set_ = VK_NULL_HANDLE;
+            LveFrameRingBuffer::Range commands_range_{};
+
+            uint32_t draw_call_count_ = 0;
+    };
+}
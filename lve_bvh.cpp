@@ -0,0 +1,413 @@
+#include "lve_bvh.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <stdexcept>
+
+namespace lve
+{
+    namespace
+    {
+        // entry distance of the ray into the box, clamped to [0, max_distance], false when it misses
+        bool intersectRay(const LveAabb& box, const glm::vec3& origin, const glm::vec3& inverse_direction, float max_distance, float& distance)
+        {
+            float t_enter = 0.0f;
+            float t_exit = max_distance;
+            for (int axis = 0; axis < 3; axis++)
+            {
+                float t0 = (box.min[axis] - origin[axis]) * inverse_direction[axis];
+                float t1 = (box.max[axis] - origin[axis]) * inverse_direction[axis];
+                if (t0 > t1)
+                {
+                    std::swap(t0, t1);
+                }
+                // written so that NaN (origin on a slab of a parallel ray) keeps the current interval
+                t_enter = t0 > t_enter ? t0 : t_enter;
+                t_exit = t1 < t_exit ? t1 : t_exit;
+                if (t_enter > t_exit)
+                {
+                    return false;
+                }
+            }
+            distance = t_enter;
+            return true;
+        }
+    }
+
+    LveBvh::LveBvh(float fat_margin) : fat_margin_{fat_margin}
+    {
+        assert(fat_margin >= 0.0f && "fat_margin must not be negative");
+    }
+
+    LveAabb LveBvh::computeWorldBounds(LveGameObject& game_obj)
+    {
+        assert(game_obj.model_ != nullptr && "game object without a model has no bounds");
+
+        // extents of the transformed box along the world axes (Arvo): |M| * e
+        const glm::mat4 transform = game_obj.transform_.mat4();
+        const glm::vec3 box_min = game_obj.model_->getBoundingBoxMin();
+        const glm::vec3 box_max = game_obj.model_->getBoundingBoxMax();
+        const glm::vec3 local_extent = 0.5f * (box_max - box_min);
+        const glm::vec3 center = glm::vec3{transform * glm::vec4{0.5f * (box_min + box_max), 1.0f}};
+        const glm::vec3 extent = glm::abs(glm::vec3{transform[0]}) * local_extent.x + glm::abs(glm::vec3{transform[1]}) * local_extent.y + glm::abs(glm::vec3{transform[2]}) * local_extent.z;
+        return {center - extent, center + extent};
+    }
+
+    void LveBvh::insert(LveGameObject::id_t object_id, const LveAabb& box)
+    {
+        if (leaf_nodes_.count(object_id) != 0)
+        {
+            throw std::runtime_error("LveBvh::insert(): object is already in the hierarchy");
+        }
+
+        const int32_t leaf = allocateNode();
+        nodes_[leaf].box = box;
+        nodes_[leaf].fat_box = fatten(box);
+        nodes_[leaf].object_id = object_id;
+        nodes_[leaf].height = 0;
+        leaf_nodes_[object_id] = leaf;
+        insertLeaf(leaf);
+    }
+
+    void LveBvh::remove(LveGameObject::id_t object_id)
+    {
+        auto it = leaf_nodes_.find(object_id);
+        if (it == leaf_nodes_.end())
+        {
+            throw std::runtime_error("LveBvh::remove(): object is not in the hierarchy");
+        }
+
+        removeLeaf(it->second);
+        freeNode(it->second);
+        leaf_nodes_.erase(it);
+    }
+
+    bool LveBvh::move(LveGameObject::id_t object_id, const LveAabb& box)
+    {
+        auto it = leaf_nodes_.find(object_id);
+        if (it == leaf_nodes_.end())
+        {
+            throw std::runtime_error("LveBvh::move(): object is not in the hierarchy");
+        }
+
+        const int32_t leaf = it->second;
+        nodes_[leaf].box = box;
+        if (nodes_[leaf].fat_box.contains(box))
+        {
+            return false;
+        }
+
+        removeLeaf(leaf);
+        nodes_[leaf].fat_box = fatten(box);
+        insertLeaf(leaf);
+        return true;
+    }
+
+    void LveBvh::clear()
+    {
+        nodes_.clear();
+        leaf_nodes_.clear();
+        root_ = NULL_NODE;
+        free_list_ = NULL_NODE;
+    }
+
+    void LveBvh::queryFrustum(const LveFrustum& frustum, std::vector<LveGameObject::id_t>& object_ids) const
+    {
+        if (root_ == NULL_NODE)
+        {
+            return;
+        }
+
+        // (node, fully inside) pairs, subtrees of a fully inside node skip the plane tests
+        std::vector<std::pair<int32_t, bool>> stack{};
+        stack.reserve(64);
+        stack.push_back({root_, false});
+        while (!stack.empty())
+        {
+            const auto [index, inside] = stack.back();
+            stack.pop_back();
+            const Node& node = nodes_[index];
+
+            auto containment = LveFrustum::Containment::Inside;
+            if (!inside)
+            {
+                const LveAabb& box = node.isLeaf() ? node.box : node.fat_box;
+                containment = frustum.classifyBox(box.min, box.max);
+                if (containment == LveFrustum::Containment::Outside)
+                {
+                    continue;
+                }
+            }
+
+            if (node.isLeaf())
+            {
+                object_ids.push_back(node.object_id);
+                continue;
+            }
+
+            const bool child_inside = containment == LveFrustum::Containment::Inside;
+            stack.push_back({node.child_left, child_inside});
+            stack.push_back({node.child_right, child_inside});
+        }
+    }
+
+    bool LveBvh::raycast(const glm::vec3& origin, const glm::vec3& direction, float max_distance, RayHit& hit) const
+    {
+        if (root_ == NULL_NODE)
+        {
+            return false;
+        }
+
+        const glm::vec3 inverse_direction{1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z};
+        float closest = max_distance;
+        bool found = false;
+
+        float distance = 0.0f;
+        if (!intersectRay(nodes_[root_].fat_box, origin, inverse_direction, closest, distance))
+        {
+            return false;
+        }
+
+        // nodes are pushed with their entry distance, anything entered beyond the closest hit is skipped
+        std::vector<std::pair<int32_t, float>> stack{};
+        stack.reserve(64);
+        stack.push_back({root_, distance});
+        while (!stack.empty())
+        {
+            const auto [index, entry] = stack.back();
+            stack.pop_back();
+            if (entry > closest)
+            {
+                continue;
+            }
+
+            const Node& node = nodes_[index];
+            if (node.isLeaf())
+            {
+                if (intersectRay(node.box, origin, inverse_direction, closest, distance))
+                {
+                    closest = distance;
+                    hit = {node.object_id, distance};
+                    found = true;
+                }
+                continue;
+            }
+
+            float left_distance = 0.0f;
+            float right_distance = 0.0f;
+            const bool left_hit = intersectRay(nodes_[node.child_left].fat_box, origin, inverse_direction, closest, left_distance);
+            const bool right_hit = intersectRay(nodes_[node.child_right].fat_box, origin, inverse_direction, closest, right_distance);
+
+            // push the farther child first so the nearer one is visited first and tightens closest
+            if (left_hit && right_hit && left_distance < right_distance)
+            {
+                stack.push_back({node.child_right, right_distance});
+                stack.push_back({node.child_left, left_distance});
+            }
+            else
+            {
+                if (left_hit)
+                {
+                    stack.push_back({node.child_left, left_distance});
+                }
+                if (right_hit)
+                {
+                    stack.push_back({node.child_right, right_distance});
+                }
+            }
+        }
+        return found;
+    }
+
+    int32_t LveBvh::allocateNode()
+    {
+        int32_t node = free_list_;
+        if (node == NULL_NODE)
+        {
+            node = static_cast<int32_t>(nodes_.size());
+            nodes_.emplace_back();
+        }
+        else
+        {
+            free_list_ = nodes_[node].parent;
+        }
+
+        Node& allocated = nodes_[node];
+        allocated.parent = NULL_NODE;
+        allocated.child_left = NULL_NODE;
+        allocated.child_right = NULL_NODE;
+        allocated.height = 0;
+        allocated.object_id = 0;
+        return node;
+    }
+
+    void LveBvh::freeNode(int32_t node)
+    {
+        nodes_[node].parent = free_list_;
+        nodes_[node].height = -1;
+        free_list_ = node;
+    }
+
+    LveAabb LveBvh::fatten(const LveAabb& box) const
+    {
+        const glm::vec3 margin = (box.max - box.min) * fat_margin_;
+        return {box.min - margin, box.max + margin};
+    }
+
+    void LveBvh::replaceChild(int32_t parent, int32_t old_child, int32_t new_child)
+    {
+        if (parent == NULL_NODE)
+        {
+            root_ = new_child;
+        }
+        else if (nodes_[parent].child_left == old_child)
+        {
+            nodes_[parent].child_left = new_child;
+        }
+        else
+        {
+            assert(nodes_[parent].child_right == old_child && "node is not a child of its parent");
+            nodes_[parent].child_right = new_child;
+        }
+    }
+
+    void LveBvh::insertLeaf(int32_t leaf)
+    {
+        if (root_ == NULL_NODE)
+        {
+            root_ = leaf;
+            nodes_[leaf].parent = NULL_NODE;
+            return;
+        }
+
+        // descend towards the sibling with the lowest surface area cost: the new parent's area plus
+        // the area every ancestor grows by
+        const LveAabb leaf_box = nodes_[leaf].fat_box;
+        int32_t index = root_;
+        while (!nodes_[index].isLeaf())
+        {
+            const Node& node = nodes_[index];
+            const float area = node.fat_box.surfaceArea();
+            const float combined_area = LveAabb::merge(node.fat_box, leaf_box).surfaceArea();
+
+            const float cost_here = 2.0f * combined_area;   // new parent of this node and the leaf
+            const float inheritance_cost = 2.0f * (combined_area - area);
+
+            auto descendCost = [&](int32_t child)
+            {
+                const LveAabb& child_box = nodes_[child].fat_box;
+                const float merged_area = LveAabb::merge(child_box, leaf_box).surfaceArea();
+                const float growth = nodes_[child].isLeaf() ? merged_area : merged_area - child_box.surfaceArea();
+                return growth + inheritance_cost;
+            };
+            const float cost_left = descendCost(node.child_left);
+            const float cost_right = descendCost(node.child_right);
+
+            if (cost_here < cost_left && cost_here < cost_right)
+            {
+                break;
+            }
+            index = cost_left < cost_right ? node.child_left : node.child_right;
+        }
+
+        const int32_t sibling = index;
+        const int32_t old_parent = nodes_[sibling].parent;
+        const int32_t new_parent = allocateNode();
+        nodes_[new_parent].parent = old_parent;
+        nodes_[new_parent].fat_box = LveAabb::merge(leaf_box, nodes_[sibling].fat_box);
+        nodes_[new_parent].height = nodes_[sibling].height + 1;
+        nodes_[new_parent].child_left = sibling;
+        nodes_[new_parent].child_right = leaf;
+        nodes_[sibling].parent = new_parent;
+        nodes_[leaf].parent = new_parent;
+        replaceChild(old_parent, sibling, new_parent);
+
+        refit(new_parent);
+    }
+
+    void LveBvh::removeLeaf(int32_t leaf)
+    {
+        if (leaf == root_)
+        {
+            root_ = NULL_NODE;
+            return;
+        }
+
+        const int32_t parent = nodes_[leaf].parent;
+        const int32_t grand_parent = nodes_[parent].parent;
+        const int32_t sibling = nodes_[parent].child_left == leaf ? nodes_[parent].child_right : nodes_[parent].child_left;
+
+        replaceChild(grand_parent, parent, sibling);
+        nodes_[sibling].parent = grand_parent;
+        freeNode(parent);
+
+        refit(grand_parent);
+    }
+
+    void LveBvh::refit(int32_t node)
+    {
+        while (node != NULL_NODE)
+        {
+            node = balance(node);
+
+            Node& current = nodes_[node];
+            const Node& left = nodes_[current.child_left];
+            const Node& right = nodes_[current.child_right];
+            current.height = 1 + std::max(left.height, right.height);
+            current.fat_box = LveAabb::merge(left.fat_box, right.fat_box);
+
+            node = current.parent;
+        }
+    }
+
+    // rotates the taller grand child up when the children's heights differ by more than one,
+    // returns the node that took a's place
+    int32_t LveBvh::balance(int32_t a)
+    {
+        if (nodes_[a].isLeaf() || nodes_[a].height < 2)
+        {
+            return a;
+        }
+
+        const int32_t b = nodes_[a].child_left;
+        const int32_t c = nodes_[a].child_right;
+        const int32_t height_difference = nodes_[c].height - nodes_[b].height;
+        if (height_difference >= -1 && height_difference <= 1)
+        {
+            return a;
+        }
+
+        // the taller child moves up into a's place, a takes the taller child's slot on that side
+        const bool rotate_right_up = height_difference > 1;
+        const int32_t up = rotate_right_up ? c : b;
+        const int32_t stay = rotate_right_up ? b : c;
+        const int32_t f = nodes_[up].child_left;
+        const int32_t g = nodes_[up].child_right;
+
+        nodes_[up].child_left = a;
+        nodes_[up].parent = nodes_[a].parent;
+        nodes_[a].parent = up;
+        replaceChild(nodes_[up].parent, a, up);
+
+        // the taller grand child stays below up, the shorter one goes to a
+        const int32_t keep = nodes_[f].height > nodes_[g].height ? f : g;
+        const int32_t give = keep == f ? g : f;
+        nodes_[up].child_right = keep;
+        if (rotate_right_up)
+        {
+            nodes_[a].child_right = give;
+        }
+        else
+        {
+            nodes_[a].child_left = give;
+        }
+        nodes_[give].parent = a;
+
+        nodes_[a].fat_box = LveAabb::merge(nodes_[stay].fat_box, nodes_[give].fat_box);
+        nodes_[a].height = 1 + std::max(nodes_[stay].height, nodes_[give].height);
+        nodes_[up].fat_box = LveAabb::merge(nodes_[a].fat_box, nodes_[keep].fat_box);
+        nodes_[up].height = 1 + std::max(nodes_[a].height, nodes_[keep].height);
+        return up;
+    }
+}
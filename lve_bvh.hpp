@@ -0,0 +1,106 @@
+#pragma once
+
+#include "lve_frustum.hpp"
+#include "lve_game_object.hpp"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace lve
+{
+    struct LveAabb
+    {
+        glm::vec3 min{};
+        glm::vec3 max{};
+
+        static LveAabb merge(const LveAabb& a, const LveAabb& b) { return {glm::min(a.min, b.min), glm::max(a.max, b.max)}; }
+
+        bool contains(const LveAabb& other) const
+        {
+            return min.x <= other.min.x && min.y <= other.min.y && min.z <= other.min.z &&
+                max.x >= other.max.x && max.y >= other.max.y && max.z >= other.max.z;
+        }
+
+        float surfaceArea() const
+        {
+            const glm::vec3 size = max - min;
+            return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+        }
+    };
+
+    /**
+        Dynamic bounding volume hierarchy over game objects, keyed by LveGameObject::id_t.
+        Leaves store the object's world box and a "fat" copy enlarged by fat_margin (a fraction of the
+        box size per side); move() is a no-op as long as the new box stays within the fat one, otherwise
+        the leaf is removed and reinserted. Inserts pick the sibling with the lowest surface area cost
+        and tree rotations on the way up keep the height logarithmic, so insert, remove and move are
+        O(log n). Frustum and ray queries only descend into overlapping subtrees, and subtrees fully
+        inside the frustum are gathered without further plane tests.
+    */
+    class LveBvh
+    {
+        public:
+            struct RayHit
+            {
+                LveGameObject::id_t object_id;
+                float distance;   // along the ray direction, in units of its length
+            };
+
+            explicit LveBvh(float fat_margin = 0.1f);
+
+            // deleting copy operator and copy constructor
+            LveBvh(const LveBvh&) = delete;
+            LveBvh &operator=(const LveBvh&) = delete;
+
+            // world space box of the object's model under its current transform
+            static LveAabb computeWorldBounds(LveGameObject& game_obj);
+
+            void insert(LveGameObject::id_t object_id, const LveAabb& box);
+            void remove(LveGameObject::id_t object_id);
+            // returns true when the leaf had to be reinserted
+            bool move(LveGameObject::id_t object_id, const LveAabb& box);
+            bool contains(LveGameObject::id_t object_id) const { return leaf_nodes_.count(object_id) != 0; }
+            void clear();
+
+            // appends the ids of all objects whose box intersects the frustum
+            void queryFrustum(const LveFrustum& frustum, std::vector<LveGameObject::id_t>& object_ids) const;
+
+            // closest object box hit by origin + t * direction with t in [0, max_distance], false if none
+            bool raycast(const glm::vec3& origin, const glm::vec3& direction, float max_distance, RayHit& hit) const;
+
+            size_t size() const { return leaf_nodes_.size(); }
+            int32_t getHeight() const { return root_ == NULL_NODE ? 0 : nodes_[root_].height; }
+
+        private:
+            static constexpr int32_t NULL_NODE = -1;
+
+            struct Node
+            {
+                LveAabb fat_box;
+                LveAabb box;      // tight box, leaves only
+                int32_t parent;   // next free node while on the free list
+                int32_t child_left;
+                int32_t child_right;
+                int32_t height;   // 0 for leaves, -1 for free nodes
+                LveGameObject::id_t object_id;
+
+                bool isLeaf() const { return child_left == NULL_NODE; }
+            };
+
+            int32_t allocateNode();
+            void freeNode(int32_t node);
+            void insertLeaf(int32_t leaf);
+            void removeLeaf(int32_t leaf);
+            int32_t balance(int32_t node);
+            void refit(int32_t node);   // recomputes boxes and heights from node up to the root
+            void replaceChild(int32_t parent, int32_t old_child, int32_t new_child);
+            LveAabb fatten(const LveAabb& box) const;
+
+            std::vector<Node> nodes_;
+            int32_t root_ = NULL_NODE;
+            int32_t free_list_ = NULL_NODE;
+            std::unordered_map<LveGameObject::id_t, int32_t> leaf_nodes_;
+            float fat_margin_;
+    };
+}
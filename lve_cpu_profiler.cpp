@@ -0,0 +1,134 @@
+#include "lve_cpu_profiler.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+namespace lve
+{
+    namespace
+    {
+        void writeEscaped(std::ostream& out, const char* text)
+        {
+            for (const char* c = text; *c != '\0'; c++)
+            {
+                if (*c == '"' || *c == '\\')
+                {
+                    out << '\\';
+                }
+                out << *c;
+            }
+        }
+    }
+
+    LveCpuProfiler& LveCpuProfiler::get()
+    {
+        static LveCpuProfiler profiler{};
+        return profiler;
+    }
+
+    LveCpuProfiler::LveCpuProfiler(): epoch_(std::chrono::steady_clock::now()) {}
+
+    uint64_t LveCpuProfiler::now() const
+    {
+        const auto elapsed = std::chrono::steady_clock::now() - epoch_;
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) + 1;
+    }
+
+    LveCpuProfiler::ThreadBuffer& LveCpuProfiler::threadBuffer()
+    {
+        thread_local ThreadBuffer* buffer = nullptr;
+        if (buffer == nullptr)
+        {
+            auto new_buffer = std::make_unique<ThreadBuffer>();
+            new_buffer->events = std::make_unique<EventSlot[]>(EVENTS_PER_THREAD);
+
+            std::lock_guard<std::mutex> lock{mutex_};
+            new_buffer->thread_id = static_cast<uint32_t>(thread_buffers_.size());
+            new_buffer->thread_name = "thread " + std::to_string(new_buffer->thread_id);
+            buffer = new_buffer.get();
+            thread_buffers_.push_back(std::move(new_buffer));
+        }
+        return *buffer;
+    }
+
+    void LveCpuProfiler::setThreadName(const std::string& name)
+    {
+        ThreadBuffer& buffer = threadBuffer();
+        std::lock_guard<std::mutex> lock{mutex_};
+        buffer.thread_name = name;
+    }
+
+    void LveCpuProfiler::record(const char* name, uint64_t begin_ns, uint64_t end_ns)
+    {
+        ThreadBuffer& buffer = threadBuffer();
+        const uint64_t index = buffer.write_count.load(std::memory_order_relaxed);
+        buffer.start_count.store(index + 1, std::memory_order_relaxed);
+        // an export that reads any of the stores below also sees start_count, and drops the slot
+        std::atomic_thread_fence(std::memory_order_release);
+
+        EventSlot& slot = buffer.events[index & (EVENTS_PER_THREAD - 1)];
+        slot.name.store(name, std::memory_order_relaxed);
+        slot.begin_ns.store(begin_ns, std::memory_order_relaxed);
+        slot.end_ns.store(end_ns, std::memory_order_relaxed);
+        buffer.write_count.store(index + 1, std::memory_order_release);
+    }
+
+    void LveCpuProfiler::writeChromeTrace(std::ostream& out)
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+
+        std::vector<Event> events{};
+        events.reserve(EVENTS_PER_THREAD);
+        bool is_first = true;
+
+        const auto old_flags = out.flags();
+        const auto old_precision = out.precision(3);
+        out << std::fixed;
+        out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+        for (const auto& buffer : thread_buffers_)
+        {
+            out << (is_first ? "" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << buffer->thread_id
+                << ", \"args\": {\"name\": \"";
+            writeEscaped(out, buffer->thread_name.c_str());
+            out << "\"}}";
+            is_first = false;
+
+            // snapshot the ring, then drop whatever the owning thread may have overwritten meanwhile
+            const uint64_t end = buffer->write_count.load(std::memory_order_acquire);
+            const uint64_t begin = end > EVENTS_PER_THREAD ? end - EVENTS_PER_THREAD : 0;
+            events.clear();
+            for (uint64_t i = begin; i < end; i++)
+            {
+                const EventSlot& slot = buffer->events[i & (EVENTS_PER_THREAD - 1)];
+                events.push_back({slot.name.load(std::memory_order_relaxed), slot.begin_ns.load(std::memory_order_relaxed), slot.end_ns.load(std::memory_order_relaxed)});
+            }
+            // pairs with the fence in record(), every overwrite started before the copies above is counted
+            std::atomic_thread_fence(std::memory_order_acquire);
+            const uint64_t started = buffer->start_count.load(std::memory_order_relaxed);
+            const uint64_t overwritten = started > EVENTS_PER_THREAD + begin ? std::min(started - EVENTS_PER_THREAD - begin, end - begin) : 0;
+
+            for (size_t i = overwritten; i < events.size(); i++)
+            {
+                const Event& event = events[i];
+                out << ",\n{\"name\": \"";
+                writeEscaped(out, event.name);
+                out << "\", \"cat\": \"cpu\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << buffer->thread_id
+                    << ", \"ts\": " << event.begin_ns / 1000.0 << ", \"dur\": " << (event.end_ns - event.begin_ns) / 1000.0 << "}";
+            }
+        }
+        out << "\n]}\n";
+        out.flags(old_flags);
+        out.precision(old_precision);
+    }
+
+    void LveCpuProfiler::saveChromeTrace(const std::string& file_path)
+    {
+        std::ofstream file{file_path};
+        if (!file)
+        {
+            throw std::runtime_error("LveCpuProfiler::saveChromeTrace(): could not open " + file_path);
+        }
+        writeChromeTrace(file);
+    }
+}
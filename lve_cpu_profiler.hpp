@@ -0,0 +1,108 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// LVE_CPU_ZONE("LveRenderer::beginFrame"); records the enclosing scope, names must be string literals
+#define LVE_CPU_ZONE_CONCAT_INNER(a, b) a##b
+#define LVE_CPU_ZONE_CONCAT(a, b) LVE_CPU_ZONE_CONCAT_INNER(a, b)
+#define LVE_CPU_ZONE(name) ::lve::LveCpuProfiler::ScopedZone LVE_CPU_ZONE_CONCAT(lve_cpu_zone_, __COUNTER__){name}
+
+namespace lve
+{
+    /**
+        Process wide CPU zone profiler, disabled until setEnabled(true).
+        Every thread writes completed zones into its own fixed size ring of events, only the owning thread
+        writes, so recording takes no locks. The slots are relaxed atomics guarded like a seqlock: a slot is
+        announced in start_count before it is written and published in write_count after, so an export running
+        concurrently copies only published slots and drops those that were overwritten while it copied them.
+        The mutex is only taken when a thread records its first zone and while exporting. Export produces Chrome trace event JSON which
+        loads in chrome://tracing and ui.perfetto.dev.
+    */
+    class LveCpuProfiler
+    {
+        public:
+            static constexpr uint64_t EVENTS_PER_THREAD = 1 << 16;   // power of two, oldest events are overwritten
+
+            class ScopedZone
+            {
+                public:
+                    explicit ScopedZone(const char* name): name_(name), begin_ns_(get().isEnabled() ? get().now() : 0) {}
+                    ~ScopedZone()
+                    {
+                        if (begin_ns_ != 0)
+                        {
+                            get().record(name_, begin_ns_, get().now());
+                        }
+                    }
+
+                    ScopedZone(const ScopedZone&) = delete;
+                    ScopedZone &operator=(const ScopedZone&) = delete;
+
+                private:
+                    const char* name_;
+                    uint64_t begin_ns_;   // 0 when the profiler was disabled at construction
+            };
+
+            static LveCpuProfiler& get();
+
+            // deleting copy operator and copy constructor
+            LveCpuProfiler(const LveCpuProfiler&) = delete;
+            LveCpuProfiler &operator=(const LveCpuProfiler&) = delete;
+
+            void setEnabled(bool enabled) { is_enabled_.store(enabled, std::memory_order_relaxed); }
+            bool isEnabled() const { return is_enabled_.load(std::memory_order_relaxed); }
+
+            // names the calling thread in exported traces
+            void setThreadName(const std::string& name);
+
+            // nanoseconds since the profiler was created, never 0
+            uint64_t now() const;
+            void record(const char* name, uint64_t begin_ns, uint64_t end_ns);
+
+            // events being overwritten by a wrapping thread while exporting are dropped rather than read torn
+            void writeChromeTrace(std::ostream& out);
+            void saveChromeTrace(const std::string& file_path);
+
+        private:
+            struct Event
+            {
+                const char* name;
+                uint64_t begin_ns;
+                uint64_t end_ns;
+            };
+
+            // Event as stored in a ring, read by the exporting thread while the owner may be overwriting it
+            struct EventSlot
+            {
+                std::atomic<const char*> name;
+                std::atomic<uint64_t> begin_ns;
+                std::atomic<uint64_t> end_ns;
+            };
+
+            struct ThreadBuffer
+            {
+                uint32_t thread_id;
+                std::string thread_name;
+                std::unique_ptr<EventSlot[]> events;
+                std::atomic<uint64_t> start_count{0};   // events whose slot is being or has been written
+                std::atomic<uint64_t> write_count{0};   // events whose slot is complete
+            };
+
+            LveCpuProfiler();
+
+            ThreadBuffer& threadBuffer();
+
+            std::atomic<bool> is_enabled_{false};
+            std::chrono::steady_clock::time_point epoch_;
+
+            std::mutex mutex_;
+            std::vector<std::unique_ptr<ThreadBuffer>> thread_buffers_;   // never shrinks, outlives the threads
+    };
+}
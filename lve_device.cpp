@@ -1,8 +1,13 @@
 #include "lve_device.hpp"
+#include "lve_pipeline_registry.hpp"
+#include "lve_upload_queue.hpp"
 
 // std headers
+#include <cstdio>
 #include <cstring>
+#include <fstream>
 #include <iostream>
+#include <iterator>
 #include <set>
 #include <unordered_set>
 
@@ -52,24 +57,44 @@ namespace lve
   }
 
   // class member functions
-  LveDevice::LveDevice(LveWindow &window) : window{window} {
+  LveDevice::LveDevice(LveWindow &window) : window{&window} {
+    init();
+  }
+
+  LveDevice::LveDevice() {
+    deviceExtensions.clear();
+    init();
+  }
+
+  void LveDevice::init() {
     createInstance();
     setupDebugMessenger();
     createSurface();
     pickPhysicalDevice();
     createLogicalDevice();
+    createAllocator();
     createCommandPool();
+    createUploadQueue();
+    createPipelineCache();
+    createPipelineRegistry();
   }
 
   LveDevice::~LveDevice() {
+    pipelineRegistry_.reset();
+    savePipelineCache();
+    vkDestroyPipelineCache(device_, pipelineCache_, nullptr);
+    uploadQueue_.reset();
     vkDestroyCommandPool(device_, commandPool, nullptr);
+    allocator_.reset();
     vkDestroyDevice(device_, nullptr);
 
     if (enableValidationLayers) {
       DestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
     }
 
-    vkDestroySurfaceKHR(instance, surface_, nullptr);
+    if (surface_ != VK_NULL_HANDLE) {
+      vkDestroySurfaceKHR(instance, surface_, nullptr);
+    }
     vkDestroyInstance(instance, nullptr);
   }
 
@@ -119,7 +144,7 @@ namespace lve
     if (deviceCount == 0) {
       throw std::runtime_error("failed to find GPUs with Vulkan support!");
     }
-    std::cout << "Device count: " << deviceCount << std::endl;
+    std::cerr << "Device count: " << deviceCount << std::endl;
     std::vector<VkPhysicalDevice> devices(deviceCount);
     vkEnumeratePhysicalDevices(instance, &deviceCount, devices.data());
 
@@ -135,7 +160,7 @@ namespace lve
     }
 
     vkGetPhysicalDeviceProperties(physicalDevice, &properties);
-    std::cout << "physical device: " << properties.deviceName << std::endl;
+    std::cerr << "physical device: " << properties.deviceName << std::endl;
   }
 
   void LveDevice::createLogicalDevice() {
@@ -143,6 +168,9 @@ namespace lve
 
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
     std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily, indices.presentFamily};
+    if (indices.transferFamilyHasValue) {
+      uniqueQueueFamilies.insert(indices.transferFamily);
+    }
 
     float queuePriority = 1.0f;
     for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -182,6 +210,10 @@ namespace lve
 
     vkGetDeviceQueue(device_, indices.graphicsFamily, 0, &graphicsQueue_);
     vkGetDeviceQueue(device_, indices.presentFamily, 0, &presentQueue_);
+
+    // uploads run on a dedicated transfer queue when available so they overlap with rendering
+    transferQueueFamily_ = indices.transferFamilyHasValue ? indices.transferFamily : indices.graphicsFamily;
+    vkGetDeviceQueue(device_, transferQueueFamily_, 0, &transferQueue_);
   }
 
   void LveDevice::createCommandPool() {
@@ -198,15 +230,100 @@ namespace lve
     }
   }
 
-  void LveDevice::createSurface() { window.createWindowSurface(instance, &surface_); }
+  void LveDevice::createPipelineCache() {
+    std::vector<char> cacheData;
+    std::ifstream file{PIPELINE_CACHE_FILE, std::ios::binary};
+    if (file.is_open()) {
+      cacheData.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+    if (!cacheData.empty() && !isPipelineCacheCompatible(cacheData)) {
+      std::cerr << "pipeline cache " << PIPELINE_CACHE_FILE << " was written by another device or driver, starting empty" << std::endl;
+      cacheData.clear();
+    }
+
+    VkPipelineCacheCreateInfo cacheInfo = {};
+    cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cacheInfo.initialDataSize = cacheData.size();
+    cacheInfo.pInitialData = cacheData.empty() ? nullptr : cacheData.data();
+    if (vkCreatePipelineCache(device_, &cacheInfo, nullptr, &pipelineCache_) == VK_SUCCESS) {
+      return;
+    }
+
+    // the driver may still reject data that passed the header check, an empty cache always works
+    cacheInfo.initialDataSize = 0;
+    cacheInfo.pInitialData = nullptr;
+    if (vkCreatePipelineCache(device_, &cacheInfo, nullptr, &pipelineCache_) != VK_SUCCESS) {
+      throw std::runtime_error("failed to create pipeline cache!");
+    }
+  }
+
+  bool LveDevice::isPipelineCacheCompatible(const std::vector<char> &cacheData) {
+    // VkPipelineCacheHeaderVersionOne: header size, header version, vendor id, device id, cache uuid
+    constexpr size_t headerSize = 4 * sizeof(uint32_t) + VK_UUID_SIZE;
+    if (cacheData.size() < headerSize) {
+      return false;
+    }
+
+    uint32_t header[4];
+    std::memcpy(header, cacheData.data(), sizeof(header));
+    return header[0] >= headerSize && header[0] <= cacheData.size() &&
+           header[1] == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+           header[2] == properties.vendorID &&
+           header[3] == properties.deviceID &&
+           std::memcmp(cacheData.data() + sizeof(header), properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+  }
+
+  bool LveDevice::savePipelineCache() {
+    size_t dataSize = 0;
+    if (vkGetPipelineCacheData(device_, pipelineCache_, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0) {
+      return false;
+    }
+    std::vector<char> cacheData(dataSize);
+    if (vkGetPipelineCacheData(device_, pipelineCache_, &dataSize, cacheData.data()) != VK_SUCCESS) {
+      return false;
+    }
+
+    // written next to the old file and renamed over it, so a crash mid-write never leaves a truncated cache
+    const std::string tempPath = std::string{PIPELINE_CACHE_FILE} + ".tmp";
+    {
+      std::ofstream file{tempPath, std::ios::binary | std::ios::trunc};
+      if (!file.write(cacheData.data(), static_cast<std::streamsize>(dataSize))) {
+        std::cerr << "could not write pipeline cache " << tempPath << std::endl;
+        return false;
+      }
+    }
+    if (std::rename(tempPath.c_str(), PIPELINE_CACHE_FILE) != 0) {
+      std::cerr << "could not replace pipeline cache " << PIPELINE_CACHE_FILE << std::endl;
+      std::remove(tempPath.c_str());
+      return false;
+    }
+    return true;
+  }
+
+  void LveDevice::createAllocator() {
+    allocator_ = std::make_unique<LveMemoryAllocator>(device_, physicalDevice);
+  }
+
+  void LveDevice::createUploadQueue() {
+    uploadQueue_ = std::make_unique<LveUploadQueue>(*this);
+  }
+
+  void LveDevice::createPipelineRegistry() {
+    pipelineRegistry_ = std::make_unique<LvePipelineRegistry>(*this);
+  }
+
+  void LveDevice::createSurface() {
+    if (isHeadless()) return;
+    window->createWindowSurface(instance, &surface_);
+  }
 
   bool LveDevice::isDeviceSuitable(VkPhysicalDevice device) {
     QueueFamilyIndices indices = findQueueFamilies(device);
 
     bool extensionsSupported = checkDeviceExtensionSupport(device);
 
-    bool swapChainAdequate = false;
-    if (extensionsSupported) {
+    bool swapChainAdequate = isHeadless();
+    if (extensionsSupported && !isHeadless()) {
       SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
       swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
     }
@@ -266,11 +383,13 @@ namespace lve
   }
 
   std::vector<const char *> LveDevice::getRequiredExtensions() {
-    uint32_t glfwExtensionCount = 0;
-    const char **glfwExtensions;
-    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-
-    std::vector<const char *> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    std::vector<const char *> extensions;
+    if (!isHeadless()) {
+      uint32_t glfwExtensionCount = 0;
+      const char **glfwExtensions;
+      glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+      extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    }
 
     if (enableValidationLayers) {
       extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -285,17 +404,17 @@ namespace lve
     std::vector<VkExtensionProperties> extensions(extensionCount);
     vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, extensions.data());
 
-    std::cout << "available extensions:" << std::endl;
+    std::cerr << "available extensions:" << std::endl;
     std::unordered_set<std::string> available;
     for (const auto &extension : extensions) {
-      std::cout << "\t" << extension.extensionName << std::endl;
+      std::cerr << "\t" << extension.extensionName << std::endl;
       available.insert(extension.extensionName);
     }
 
-    std::cout << "required extensions:" << std::endl;
+    std::cerr << "required extensions:" << std::endl;
     auto requiredExtensions = getRequiredExtensions();
     for (const auto &required : requiredExtensions) {
-      std::cout << "\t" << required << std::endl;
+      std::cerr << "\t" << required << std::endl;
       if (available.find(required) == available.end()) {
         throw std::runtime_error("Missing required glfw extension");
       }
@@ -337,8 +456,11 @@ namespace lve
         indices.graphicsFamily = i;
         indices.graphicsFamilyHasValue = true;
       }
-      VkBool32 presentSupport = false;
-      vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &presentSupport);
+      // nothing is presented when headless, the graphics family stands in as present family
+      VkBool32 presentSupport = isHeadless() && indices.graphicsFamilyHasValue;
+      if (!isHeadless()) {
+        vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &presentSupport);
+      }
       if (queueFamily.queueCount > 0 && presentSupport) {
         indices.presentFamily = i;
         indices.presentFamilyHasValue = true;
@@ -350,6 +472,16 @@ namespace lve
       i++;
     }
 
+    for (uint32_t family = 0; family < queueFamilyCount; family++) {
+      const VkQueueFlags flags = queueFamilies[family].queueFlags;
+      if (queueFamilies[family].queueCount > 0 && (flags & VK_QUEUE_TRANSFER_BIT) &&
+          !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))) {
+        indices.transferFamily = family;
+        indices.transferFamilyHasValue = true;
+        break;
+      }
+    }
+
     return indices;
   }
 
@@ -413,13 +545,23 @@ namespace lve
       VkBufferUsageFlags usage,
       VkMemoryPropertyFlags properties,
       VkBuffer &buffer,
-      VkDeviceMemory &bufferMemory) {
+      LveAllocation &bufferAllocation) {
     VkBufferCreateInfo bufferInfo{};
     bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
     bufferInfo.size = size;
     bufferInfo.usage = usage;
     bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
+    // buffers filled by the transfer queue are shared with the graphics queue instead of
+    // requiring a queue family ownership transfer after every upload
+    QueueFamilyIndices indices = findPhysicalQueueFamilies();
+    uint32_t queueFamilyIndices[] = {indices.graphicsFamily, transferQueueFamily_};
+    if ((usage & VK_BUFFER_USAGE_TRANSFER_DST_BIT) && transferQueueFamily_ != indices.graphicsFamily) {
+      bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+      bufferInfo.queueFamilyIndexCount = 2;
+      bufferInfo.pQueueFamilyIndices = queueFamilyIndices;
+    }
+
     if (vkCreateBuffer(device_, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
       throw std::runtime_error("failed to create vertex buffer!");
     }
@@ -427,16 +569,16 @@ namespace lve
     VkMemoryRequirements memRequirements;
     vkGetBufferMemoryRequirements(device_, buffer, &memRequirements);
 
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+    bufferAllocation = allocator_->allocate(memRequirements, properties, true);
 
-    if (vkAllocateMemory(device_, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
-      throw std::runtime_error("failed to allocate vertex buffer memory!");
+    if (vkBindBufferMemory(device_, buffer, bufferAllocation.memory, bufferAllocation.offset) != VK_SUCCESS) {
+      throw std::runtime_error("failed to bind buffer memory!");
     }
+  }
 
-    vkBindBufferMemory(device_, buffer, bufferMemory, 0);
+  void LveDevice::destroyBuffer(VkBuffer buffer, LveAllocation &bufferAllocation) {
+    vkDestroyBuffer(device_, buffer, nullptr);
+    allocator_->free(bufferAllocation);
   }
 
   VkCommandBuffer LveDevice::beginSingleTimeCommands() {
@@ -465,56 +607,37 @@ namespace lve
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers = &commandBuffer;
 
-    vkQueueSubmit(graphicsQueue_, 1, &submitInfo, VK_NULL_HANDLE);
-    vkQueueWaitIdle(graphicsQueue_);
+    // wait on a fence for this submission only instead of draining the whole graphics queue
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    VkFence fence;
+    if (vkCreateFence(device_, &fenceInfo, nullptr, &fence) != VK_SUCCESS) {
+      throw std::runtime_error("failed to create single time command fence!");
+    }
+
+    vkQueueSubmit(graphicsQueue_, 1, &submitInfo, fence);
+    vkWaitForFences(device_, 1, &fence, VK_TRUE, UINT64_MAX);
 
+    vkDestroyFence(device_, fence, nullptr);
     vkFreeCommandBuffers(device_, commandPool, 1, &commandBuffer);
   }
 
   void LveDevice::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
-    VkCommandBuffer commandBuffer = beginSingleTimeCommands();
-
-    VkBufferCopy copyRegion{};
-    copyRegion.srcOffset = 0;  // Optional
-    copyRegion.dstOffset = 0;  // Optional
-    copyRegion.size = size;
-    vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
-
-    endSingleTimeCommands(commandBuffer);
+    uploadQueue_->copyBuffer(srcBuffer, dstBuffer, size);
+    uploadQueue_->wait(uploadQueue_->submit());
   }
 
   void LveDevice::copyBufferToImage(
       VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layerCount) {
-    VkCommandBuffer commandBuffer = beginSingleTimeCommands();
-
-    VkBufferImageCopy region{};
-    region.bufferOffset = 0;
-    region.bufferRowLength = 0;
-    region.bufferImageHeight = 0;
-
-    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    region.imageSubresource.mipLevel = 0;
-    region.imageSubresource.baseArrayLayer = 0;
-    region.imageSubresource.layerCount = layerCount;
-
-    region.imageOffset = {0, 0, 0};
-    region.imageExtent = {width, height, 1};
-
-    vkCmdCopyBufferToImage(
-        commandBuffer,
-        buffer,
-        image,
-        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-        1,
-        &region);
-    endSingleTimeCommands(commandBuffer);
+    uploadQueue_->copyBufferToImage(buffer, image, width, height, layerCount);
+    uploadQueue_->wait(uploadQueue_->submit());
   }
 
   void LveDevice::createImageWithInfo(
       const VkImageCreateInfo &imageInfo,
       VkMemoryPropertyFlags properties,
       VkImage &image,
-      VkDeviceMemory &imageMemory) {
+      LveAllocation &imageAllocation) {
     if (vkCreateImage(device_, &imageInfo, nullptr, &image) != VK_SUCCESS) {
       throw std::runtime_error("failed to create image!");
     }
@@ -522,18 +645,17 @@ namespace lve
     VkMemoryRequirements memRequirements;
     vkGetImageMemoryRequirements(device_, image, &memRequirements);
 
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+    const bool linearImage = imageInfo.tiling == VK_IMAGE_TILING_LINEAR;
+    imageAllocation = allocator_->allocate(memRequirements, properties, linearImage);
 
-    if (vkAllocateMemory(device_, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
-      throw std::runtime_error("failed to allocate image memory!");
-    }
-
-    if (vkBindImageMemory(device_, image, imageMemory, 0) != VK_SUCCESS) {
+    if (vkBindImageMemory(device_, image, imageAllocation.memory, imageAllocation.offset) != VK_SUCCESS) {
       throw std::runtime_error("failed to bind image memory!");
     }
   }
 
+  void LveDevice::destroyImage(VkImage image, LveAllocation &imageAllocation) {
+    vkDestroyImage(device_, image, nullptr);
+    allocator_->free(imageAllocation);
+  }
+
 }  // namespace lve
\ No newline at end of file
@@ -1,13 +1,18 @@
 #pragma once
 
 #include "lve_window.hpp"
+#include "lve_memory_allocator.hpp"
 
 // std lib headers
+#include <memory>
 #include <string>
 #include <vector>
 
 namespace lve
 {
+  class LvePipelineRegistry;
+  class LveUploadQueue;
+
   struct SwapChainSupportDetails
   {
     VkSurfaceCapabilitiesKHR capabilities;
@@ -19,8 +24,10 @@ namespace lve
   {
     uint32_t graphicsFamily;
     uint32_t presentFamily;
+    uint32_t transferFamily;  // dedicated transfer-only family, if the device exposes one
     bool graphicsFamilyHasValue = false;
     bool presentFamilyHasValue = false;
+    bool transferFamilyHasValue = false;
     bool isComplete() { return graphicsFamilyHasValue && presentFamilyHasValue; }
   };
 
@@ -34,6 +41,8 @@ namespace lve
     #endif
 
       LveDevice(LveWindow &window);
+      // headless: no window, surface or swap chain extension; LveSwapChain renders to offscreen images
+      LveDevice();
       ~LveDevice();
 
       // Not copyable or movable
@@ -44,9 +53,23 @@ namespace lve
 
       VkCommandPool getCommandPool() { return commandPool; }
       VkDevice device() { return device_; }
+      VkPhysicalDevice getPhysicalDevice() { return physicalDevice; }
       VkSurfaceKHR surface() { return surface_; }
+      bool isHeadless() const { return window == nullptr; }
       VkQueue graphicsQueue() { return graphicsQueue_; }
       VkQueue presentQueue() { return presentQueue_; }
+      VkQueue transferQueue() { return transferQueue_; }  // graphics queue if there is no dedicated transfer family
+      uint32_t transferQueueFamily() { return transferQueueFamily_; }
+      LveMemoryAllocator &allocator() { return *allocator_; }
+      LveUploadQueue &uploadQueue() { return *uploadQueue_; }
+
+      // shared by every pipeline, loaded from PIPELINE_CACHE_FILE at startup and written back on destruction
+      static constexpr const char *PIPELINE_CACHE_FILE = "pipeline_cache.bin";
+      VkPipelineCache pipelineCache() { return pipelineCache_; }
+      // writes the cache to PIPELINE_CACHE_FILE now, returns false (and leaves the old file) on failure
+      bool savePipelineCache();
+      // deduplicated shader modules, pipeline layouts and pipelines, thread safe
+      LvePipelineRegistry &pipelineRegistry() { return *pipelineRegistry_; }
 
       SwapChainSupportDetails getSwapChainSupport() { return querySwapChainSupport(physicalDevice); }
       uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
@@ -55,15 +78,18 @@ namespace lve
           const std::vector<VkFormat> &candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
 
       // Buffer Helper Functions
+      // memory is sub-allocated from LveMemoryAllocator blocks, release with destroyBuffer()
       void createBuffer(
           VkDeviceSize size,
           VkBufferUsageFlags usage,
           VkMemoryPropertyFlags properties,
           VkBuffer &buffer,
-          VkDeviceMemory &bufferMemory
+          LveAllocation &bufferAllocation
         );
+      void destroyBuffer(VkBuffer buffer, LveAllocation &bufferAllocation);
       VkCommandBuffer beginSingleTimeCommands();
       void endSingleTimeCommands(VkCommandBuffer commandBuffer);
+      // blocking helpers, use uploadQueue() directly to batch copies and poll for completion
       void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
       void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layerCount);
 
@@ -71,8 +97,9 @@ namespace lve
           const VkImageCreateInfo &imageInfo,
           VkMemoryPropertyFlags properties,
           VkImage &image,
-          VkDeviceMemory &imageMemory
+          LveAllocation &imageAllocation
         );
+      void destroyImage(VkImage image, LveAllocation &imageAllocation);
 
       VkPhysicalDeviceProperties properties;
 
@@ -83,6 +110,11 @@ namespace lve
       void pickPhysicalDevice();
       void createLogicalDevice();
       void createCommandPool();
+      void createAllocator();
+      void createUploadQueue();
+      void createPipelineCache();
+      void createPipelineRegistry();
+      bool isPipelineCacheCompatible(const std::vector<char> &cacheData);
 
       // helper functions
       bool isDeviceSuitable(VkPhysicalDevice device);
@@ -90,6 +122,7 @@ namespace lve
       bool checkValidationLayerSupport();
       QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device);
       void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT &createInfo);
+      void init();
       void hasGflwRequiredInstanceExtensions();
       bool checkDeviceExtensionSupport(VkPhysicalDevice device);
       SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device);
@@ -97,16 +130,22 @@ namespace lve
       VkInstance instance;
       VkDebugUtilsMessengerEXT debugMessenger;
       VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
-      LveWindow &window;
+      LveWindow *window = nullptr;
       VkCommandPool commandPool;
+      std::unique_ptr<LveMemoryAllocator> allocator_;
+      std::unique_ptr<LveUploadQueue> uploadQueue_;
+      VkPipelineCache pipelineCache_ = VK_NULL_HANDLE;
+      std::unique_ptr<LvePipelineRegistry> pipelineRegistry_;
 
       VkDevice device_;
-      VkSurfaceKHR surface_;
+      VkSurfaceKHR surface_ = VK_NULL_HANDLE;
       VkQueue graphicsQueue_;
       VkQueue presentQueue_;
+      VkQueue transferQueue_;
+      uint32_t transferQueueFamily_;
 
       const std::vector<const char *> validationLayers = {"VK_LAYER_KHRONOS_validation"};
-      const std::vector<const char *> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+      std::vector<const char *> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
     };
 
 }  // namespace lve
\ No newline at end of file
@@ -0,0 +1,104 @@
+#include "lve_draw_list.hpp"
+#include "lve_job_system.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+
+namespace lve
+{
+    uint64_t LveDrawList::makeKey(uint32_t pipeline, uint32_t model, uint32_t material, float depth)
+    {
+        assert(pipeline < MAX_PIPELINES && "LveDrawList::makeKey(): pipeline id out of range");
+        assert(model < MAX_MODELS && "LveDrawList::makeKey(): model id out of range");
+        assert(material < MAX_MATERIALS && "LveDrawList::makeKey(): material id out of range");
+
+        constexpr uint32_t depth_max = (1u << 24) - 1;
+        const uint64_t quantized_depth = static_cast<uint64_t>(std::clamp(depth, 0.0f, 1.0f) * depth_max);
+
+        return static_cast<uint64_t>(pipeline) << 56 |
+            static_cast<uint64_t>(model) << 40 |
+            static_cast<uint64_t>(material) << 24 |
+            quantized_depth;
+    }
+
+    void LveDrawList::sort(LveJobSystem* job_system)
+    {
+        const size_t count = items_.size();
+        if (count < 2)
+        {
+            return;
+        }
+        scratch_.resize(count);
+
+        // the ranges stay the same for all passes, shorter ones are not worth a job
+        constexpr size_t min_range_size = 16384;
+        const size_t max_ranges = job_system != nullptr ? static_cast<size_t>(job_system->getWorkerCount() + 1) * 2 : 1;
+        const size_t range_count = std::clamp<size_t>(count / min_range_size, 1, max_ranges);
+        const size_t range_size = (count + range_count - 1) / range_count;
+        range_offsets_.resize(range_count);
+
+        auto for_each_range = [&](const auto& function)
+        {
+            if (range_count == 1)
+            {
+                function(0, 0, count);
+                return;
+            }
+            job_system->parallelFor(range_count, 1, [&](size_t first_range, size_t last_range)
+            {
+                for (size_t range = first_range; range < last_range; range++)
+                {
+                    function(range, range * range_size, std::min(count, (range + 1) * range_size));
+                }
+            });
+        };
+
+        for (uint32_t shift = 0; shift < 64; shift += 8)
+        {
+            for_each_range([this, shift](size_t range, size_t begin, size_t end)
+            {
+                auto& counts = range_offsets_[range];
+                counts.fill(0);
+                for (size_t i = begin; i < end; i++)
+                {
+                    counts[(items_[i].key >> shift) & 0xff]++;
+                }
+            });
+
+            // every key has the same digit, this pass would not move anything
+            const size_t first_digit = (items_[0].key >> shift) & 0xff;
+            size_t first_digit_count = 0;
+            for (const auto& counts : range_offsets_)
+            {
+                first_digit_count += counts[first_digit];
+            }
+            if (first_digit_count == count)
+            {
+                continue;
+            }
+
+            // digit major, range minor: each range writes its keys of a digit after those of earlier ranges
+            size_t total = 0;
+            for (size_t digit = 0; digit < 256; digit++)
+            {
+                for (auto& counts : range_offsets_)
+                {
+                    const size_t digit_count = counts[digit];
+                    counts[digit] = total;
+                    total += digit_count;
+                }
+            }
+
+            for_each_range([this, shift](size_t range, size_t begin, size_t end)
+            {
+                auto& offsets = range_offsets_[range];
+                for (size_t i = begin; i < end; i++)
+                {
+                    scratch_[offsets[(items_[i].key >> shift) & 0xff]++] = items_[i];
+                }
+            });
+            items_.swap(scratch_);
+        }
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace lve
+{
+    class LveJobSystem;
+
+    /**
+        Per-frame list of draws ordered by a 64-bit sort key, most significant field first:
+            | pipeline (8 bits) | model (16 bits) | material (16 bits) | depth (24 bits) |
+        so that after sort() draws sharing a pipeline, then a model, are adjacent and binds only have to
+        be recorded when a field changes. Keys are sorted with an LSD radix sort, byte passes whose digit
+        is the same for every key are skipped. Large lists can be sorted on an LveJobSystem: every pass
+        counts digits per range in parallel, prefix sums give each range its own output slots, and the
+        ranges scatter in parallel, which keeps the sort stable.
+    */
+    class LveDrawList
+    {
+        public:
+            static constexpr uint32_t MAX_PIPELINES = 1u << 8;
+            static constexpr uint32_t MAX_MODELS = 1u << 16;
+            static constexpr uint32_t MAX_MATERIALS = 1u << 16;
+
+            struct Item
+            {
+                uint64_t key;
+                uint32_t object_index;   // index into the caller's object array
+            };
+
+            // filled in by whoever records the sorted list
+            struct BindStats
+            {
+                uint32_t draw_count = 0;
+                uint32_t pipeline_binds = 0;
+                uint32_t model_binds = 0;
+
+                // compared to binding pipeline and model for every draw
+                uint32_t pipelineBindsSaved() const { return draw_count - pipeline_binds; }
+                uint32_t modelBindsSaved() const { return draw_count - model_binds; }
+            };
+
+            // depth in [0, 1] (clamped), smaller depths sort first which gives front to back order for opaque draws
+            static uint64_t makeKey(uint32_t pipeline, uint32_t model, uint32_t material, float depth);
+            static uint32_t pipelineOf(uint64_t key) { return static_cast<uint32_t>(key >> 56); }
+            static uint32_t modelOf(uint64_t key) { return static_cast<uint32_t>(key >> 40) & 0xffff; }
+            static uint32_t materialOf(uint64_t key) { return static_cast<uint32_t>(key >> 24) & 0xffff; }
+
+            void clear() { items_.clear(); }
+            void reserve(size_t count) { items_.reserve(count); }
+            void add(uint64_t key, uint32_t object_index) { items_.push_back({key, object_index}); }
+
+            void sort(LveJobSystem* job_system = nullptr);
+
+            const std::vector<Item>& getItems() const { return items_; }
+            size_t size() const { return items_.size(); }
+
+        private:
+            std::vector<Item> items_;
+            std::vector<Item> scratch_;   // ping-pong buffer of the radix sort, kept to avoid per-frame allocations
+            std::vector<std::array<size_t, 256>> range_offsets_;   // per range digit counts, then offsets, of a parallel pass
+    };
+}
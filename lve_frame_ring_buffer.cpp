@@ -0,0 +1,61 @@
+#include "lve_frame_ring_buffer.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace lve
+{
+    LveFrameRingBuffer::LveFrameRingBuffer(LveDevice& device, VkDeviceSize bytes_per_frame, int frame_count): lve_device_(device), bytes_per_frame_(bytes_per_frame), frame_count_(frame_count)
+    {
+        assert(frame_count_ > 0 && "LveFrameRingBuffer needs at least one frame region");
+
+        const auto& limits = lve_device_.properties.limits;
+        default_alignment_ = std::max<VkDeviceSize>({16, limits.minUniformBufferOffsetAlignment, limits.minStorageBufferOffsetAlignment});
+
+        lve_device_.createBuffer(
+            bytes_per_frame_ * frame_count_,
+            VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
+                VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+                VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            buffer_,
+            allocation_
+        );
+    }
+
+    LveFrameRingBuffer::~LveFrameRingBuffer()
+    {
+        lve_device_.destroyBuffer(buffer_, allocation_);
+    }
+
+    void LveFrameRingBuffer::beginFrame(int frame_index)
+    {
+        assert(frame_index >= 0 && frame_index < frame_count_ && "LveFrameRingBuffer::beginFrame(): frame index out of range");
+
+        region_begin_ = bytes_per_frame_ * frame_index;
+        head_ = region_begin_;
+    }
+
+    LveFrameRingBuffer::Range LveFrameRingBuffer::allocate(VkDeviceSize size, VkDeviceSize alignment)
+    {
+        if (alignment == 0)
+        {
+            alignment = default_alignment_;
+        }
+
+        const VkDeviceSize offset = (head_ + alignment - 1) / alignment * alignment;
+        if (offset + size > region_begin_ + bytes_per_frame_)
+        {
+            throw std::runtime_error("LveFrameRingBuffer::allocate(): per-frame region exhausted");
+        }
+        head_ = offset + size;
+
+        Range range{};
+        range.buffer = buffer_;
+        range.offset = offset;
+        range.size = size;
+        range.mapped = static_cast<char*>(allocation_.mapped) + offset;
+        return range;
+    }
+}
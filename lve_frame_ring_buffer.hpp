@@ -0,0 +1,53 @@
+#pragma once
+
+#include "lve_device.hpp"
+
+namespace lve
+{
+    /**
+        One persistently mapped host visible buffer split into MAX_FRAMES_IN_FLIGHT regions.
+        allocate() bumps a pointer inside the region of the current frame and never touches the
+        Vulkan allocator, so per-frame uniforms, instance data, indirect commands and dynamic vertices
+        stream without any allocations. A region is reset by beginFrame() once the in-flight fence of the frame that
+        last used it has signaled (LveRenderer calls it right after LveSwapChain::acquireNextImage()).
+    */
+    class LveFrameRingBuffer
+    {
+        public:
+            struct Range
+            {
+                VkBuffer buffer = VK_NULL_HANDLE;
+                VkDeviceSize offset = 0;   // offset into buffer, use for binds and descriptor writes
+                VkDeviceSize size = 0;
+                void* mapped = nullptr;    // host pointer to the start of the range
+            };
+
+            LveFrameRingBuffer(LveDevice& device, VkDeviceSize bytes_per_frame, int frame_count);
+            ~LveFrameRingBuffer();
+
+            // deleting copy operator and copy constructor
+            LveFrameRingBuffer(const LveFrameRingBuffer&) = delete;
+            LveFrameRingBuffer &operator=(const LveFrameRingBuffer&) = delete;
+
+            void beginFrame(int frame_index);
+
+            // alignment of 0 means the device's uniform/storage buffer offset alignment
+            Range allocate(VkDeviceSize size, VkDeviceSize alignment = 0);
+
+            VkBuffer getBuffer() const { return buffer_; }
+            VkDeviceSize getBytesPerFrame() const { return bytes_per_frame_; }
+            VkDeviceSize getBytesUsed() const { return head_ - region_begin_; }
+
+        private:
+            LveDevice& lve_device_;
+            VkBuffer buffer_;
+            LveAllocation allocation_;
+
+            VkDeviceSize bytes_per_frame_;
+            int frame_count_;
+            VkDeviceSize default_alignment_;
+
+            VkDeviceSize region_begin_ = 0;
+            VkDeviceSize head_ = 0;
+    };
+}
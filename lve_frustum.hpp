@@ -0,0 +1,82 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <array>
+
+namespace lve
+{
+    /**
+        Six planes (left, right, bottom, top, near, far) as (normal, distance) with normals pointing inside,
+        so a point p is inside when dot(plane.xyz, p) + plane.w >= 0 for every plane.
+        Extracted from a view projection matrix with the Gribb/Hartmann method, for a [0, 1] depth range.
+    */
+    struct LveFrustum
+    {
+        std::array<glm::vec4, 6> planes{};
+
+        static LveFrustum fromMatrix(const glm::mat4& view_projection)
+        {
+            const glm::vec4 row0{view_projection[0][0], view_projection[1][0], view_projection[2][0], view_projection[3][0]};
+            const glm::vec4 row1{view_projection[0][1], view_projection[1][1], view_projection[2][1], view_projection[3][1]};
+            const glm::vec4 row2{view_projection[0][2], view_projection[1][2], view_projection[2][2], view_projection[3][2]};
+            const glm::vec4 row3{view_projection[0][3], view_projection[1][3], view_projection[2][3], view_projection[3][3]};
+
+            LveFrustum frustum{};
+            frustum.planes[0] = row3 + row0;   // left
+            frustum.planes[1] = row3 - row0;   // right
+            frustum.planes[2] = row3 + row1;   // bottom
+            frustum.planes[3] = row3 - row1;   // top
+            frustum.planes[4] = row2;          // near, z >= 0
+            frustum.planes[5] = row3 - row2;   // far
+            for (auto& plane : frustum.planes)
+            {
+                plane /= glm::length(glm::vec3{plane});
+            }
+            return frustum;
+        }
+
+        bool intersectsSphere(const glm::vec3& center, float radius) const
+        {
+            for (const auto& plane : planes)
+            {
+                if (glm::dot(glm::vec3{plane}, center) + plane.w < -radius)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        enum class Containment
+        {
+            Outside,
+            Intersecting,
+            Inside
+        };
+
+        // axis aligned box given by its corners, Inside means no plane cuts it
+        Containment classifyBox(const glm::vec3& box_min, const glm::vec3& box_max) const
+        {
+            const glm::vec3 center = 0.5f * (box_min + box_max);
+            const glm::vec3 extent = 0.5f * (box_max - box_min);
+            Containment result = Containment::Inside;
+            for (const auto& plane : planes)
+            {
+                const float distance = glm::dot(glm::vec3{plane}, center) + plane.w;
+                const float radius = glm::dot(glm::abs(glm::vec3{plane}), extent);
+                if (distance < -radius)
+                {
+                    return Containment::Outside;
+                }
+                if (distance < radius)
+                {
+                    result = Containment::Intersecting;
+                }
+            }
+            return result;
+        }
+    };
+}
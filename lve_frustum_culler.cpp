@@ -0,0 +1,318 @@
+#include "lve_frustum_culler.hpp"
+#include "lve_cpu_profiler.hpp"
+#include "lve_job_system.hpp"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+
+namespace lve
+{
+    namespace
+    {
+        constexpr size_t KERNEL_PADDING = 8;   // lanes of the widest kernel
+        constexpr size_t PARALLEL_RANGE_SIZE = 1024;   // smallest number of objects culled by one job
+
+        // per plane: normal, distance and absolute normal, splatted by the kernels
+        struct PackedPlane
+        {
+            float nx, ny, nz, w;
+            float abs_nx, abs_ny, abs_nz;
+        };
+
+        struct PackedBounds
+        {
+            const float* center_x;
+            const float* center_y;
+            const float* center_z;
+            const float* extent_x;
+            const float* extent_y;
+            const float* extent_z;
+            const float* radius;
+        };
+
+#if defined(__AVX__)
+        constexpr const char* KERNEL_NAME = "avx";
+
+        void cullKernel(const PackedPlane* planes, const PackedBounds& bounds, size_t count, uint8_t* visible)
+        {
+            for (size_t i = 0; i < count; i += 8)
+            {
+                const __m256 cx = _mm256_loadu_ps(bounds.center_x + i);
+                const __m256 cy = _mm256_loadu_ps(bounds.center_y + i);
+                const __m256 cz = _mm256_loadu_ps(bounds.center_z + i);
+                const __m256 ex = _mm256_loadu_ps(bounds.extent_x + i);
+                const __m256 ey = _mm256_loadu_ps(bounds.extent_y + i);
+                const __m256 ez = _mm256_loadu_ps(bounds.extent_z + i);
+                const __m256 radius = _mm256_loadu_ps(bounds.radius + i);
+
+                __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+                for (size_t p = 0; p < 6; p++)
+                {
+                    const PackedPlane& plane = planes[p];
+                    __m256 distance = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.nx), cx), _mm256_set1_ps(plane.w));
+                    distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(plane.ny), cy));
+                    distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(plane.nz), cz));
+                    __m256 box_radius = _mm256_mul_ps(_mm256_set1_ps(plane.abs_nx), ex);
+                    box_radius = _mm256_add_ps(box_radius, _mm256_mul_ps(_mm256_set1_ps(plane.abs_ny), ey));
+                    box_radius = _mm256_add_ps(box_radius, _mm256_mul_ps(_mm256_set1_ps(plane.abs_nz), ez));
+                    const __m256 reach = _mm256_add_ps(distance, _mm256_min_ps(box_radius, radius));
+                    inside = _mm256_and_ps(inside, _mm256_cmp_ps(reach, _mm256_setzero_ps(), _CMP_GE_OQ));
+                }
+
+                const int mask = _mm256_movemask_ps(inside);
+                for (size_t lane = 0; lane < 8; lane++)
+                {
+                    visible[i + lane] = (mask >> lane) & 1;
+                }
+            }
+        }
+#elif defined(__SSE2__) || defined(_M_X64)
+        constexpr const char* KERNEL_NAME = "sse";
+
+        void cullKernel(const PackedPlane* planes, const PackedBounds& bounds, size_t count, uint8_t* visible)
+        {
+            for (size_t i = 0; i < count; i += 4)
+            {
+                const __m128 cx = _mm_loadu_ps(bounds.center_x + i);
+                const __m128 cy = _mm_loadu_ps(bounds.center_y + i);
+                const __m128 cz = _mm_loadu_ps(bounds.center_z + i);
+                const __m128 ex = _mm_loadu_ps(bounds.extent_x + i);
+                const __m128 ey = _mm_loadu_ps(bounds.extent_y + i);
+                const __m128 ez = _mm_loadu_ps(bounds.extent_z + i);
+                const __m128 radius = _mm_loadu_ps(bounds.radius + i);
+
+                __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+                for (size_t p = 0; p < 6; p++)
+                {
+                    const PackedPlane& plane = planes[p];
+                    __m128 distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.nx), cx), _mm_set1_ps(plane.w));
+                    distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane.ny), cy));
+                    distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane.nz), cz));
+                    __m128 box_radius = _mm_mul_ps(_mm_set1_ps(plane.abs_nx), ex);
+                    box_radius = _mm_add_ps(box_radius, _mm_mul_ps(_mm_set1_ps(plane.abs_ny), ey));
+                    box_radius = _mm_add_ps(box_radius, _mm_mul_ps(_mm_set1_ps(plane.abs_nz), ez));
+                    const __m128 reach = _mm_add_ps(distance, _mm_min_ps(box_radius, radius));
+                    inside = _mm_and_ps(inside, _mm_cmpge_ps(reach, _mm_setzero_ps()));
+                }
+
+                const int mask = _mm_movemask_ps(inside);
+                for (size_t lane = 0; lane < 4; lane++)
+                {
+                    visible[i + lane] = (mask >> lane) & 1;
+                }
+            }
+        }
+#elif defined(__ARM_NEON)
+        constexpr const char* KERNEL_NAME = "neon";
+
+        void cullKernel(const PackedPlane* planes, const PackedBounds& bounds, size_t count, uint8_t* visible)
+        {
+            for (size_t i = 0; i < count; i += 4)
+            {
+                const float32x4_t cx = vld1q_f32(bounds.center_x + i);
+                const float32x4_t cy = vld1q_f32(bounds.center_y + i);
+                const float32x4_t cz = vld1q_f32(bounds.center_z + i);
+                const float32x4_t ex = vld1q_f32(bounds.extent_x + i);
+                const float32x4_t ey = vld1q_f32(bounds.extent_y + i);
+                const float32x4_t ez = vld1q_f32(bounds.extent_z + i);
+                const float32x4_t radius = vld1q_f32(bounds.radius + i);
+
+                uint32x4_t inside = vdupq_n_u32(0xffffffff);
+                for (size_t p = 0; p < 6; p++)
+                {
+                    const PackedPlane& plane = planes[p];
+                    float32x4_t distance = vmlaq_n_f32(vdupq_n_f32(plane.w), cx, plane.nx);
+                    distance = vmlaq_n_f32(distance, cy, plane.ny);
+                    distance = vmlaq_n_f32(distance, cz, plane.nz);
+                    float32x4_t box_radius = vmulq_n_f32(ex, plane.abs_nx);
+                    box_radius = vmlaq_n_f32(box_radius, ey, plane.abs_ny);
+                    box_radius = vmlaq_n_f32(box_radius, ez, plane.abs_nz);
+                    const float32x4_t reach = vaddq_f32(distance, vminq_f32(box_radius, radius));
+                    inside = vandq_u32(inside, vcgeq_f32(reach, vdupq_n_f32(0.0f)));
+                }
+
+                visible[i + 0] = vgetq_lane_u32(inside, 0) != 0;
+                visible[i + 1] = vgetq_lane_u32(inside, 1) != 0;
+                visible[i + 2] = vgetq_lane_u32(inside, 2) != 0;
+                visible[i + 3] = vgetq_lane_u32(inside, 3) != 0;
+            }
+        }
+#else
+        constexpr const char* KERNEL_NAME = "scalar";
+
+        // visible when for every plane the signed distance of the center is not below -min(box radius, sphere radius)
+        inline bool testScalar(const PackedPlane* planes, const PackedBounds& bounds, size_t i)
+        {
+            for (size_t p = 0; p < 6; p++)
+            {
+                const PackedPlane& plane = planes[p];
+                const float distance = plane.nx * bounds.center_x[i] + plane.ny * bounds.center_y[i] + plane.nz * bounds.center_z[i] + plane.w;
+                const float box_radius = plane.abs_nx * bounds.extent_x[i] + plane.abs_ny * bounds.extent_y[i] + plane.abs_nz * bounds.extent_z[i];
+                if (distance + std::min(box_radius, bounds.radius[i]) < 0.0f)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        void cullKernel(const PackedPlane* planes, const PackedBounds& bounds, size_t count, uint8_t* visible)
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                visible[i] = testScalar(planes, bounds, i);
+            }
+        }
+#endif
+    }
+
+    const char* LveFrustumCuller::getKernelName()
+    {
+        return KERNEL_NAME;
+    }
+
+    void LveFrustumCuller::clearBounds()
+    {
+        bounds_sources_.clear();
+        object_indices_.clear();
+    }
+
+    void LveFrustumCuller::addBounds(uint32_t object_index, TransformComponent& transform, const LveModel& model)
+    {
+        bounds_sources_.push_back({&transform, &model});
+        object_indices_.push_back(object_index);
+    }
+
+    void LveFrustumCuller::packBounds(size_t slot)
+    {
+        // the sphere is centered on the box (see LveModel::computeBounds()), so both share the world center
+        const LveModel& model = *bounds_sources_[slot].model;
+        const glm::mat4& transform = bounds_sources_[slot].transform->mat4();
+        const glm::vec3 box_min = model.getBoundingBoxMin();
+        const glm::vec3 box_max = model.getBoundingBoxMax();
+        const glm::vec3 local_center = 0.5f * (box_min + box_max);
+        const glm::vec3 local_extent = 0.5f * (box_max - box_min);
+        const glm::vec3 center = glm::vec3{transform * glm::vec4{local_center, 1.0f}};
+
+        // extents of the transformed box along the world axes (Arvo): |M| * e
+        const glm::vec3 axis_x = glm::vec3{transform[0]};
+        const glm::vec3 axis_y = glm::vec3{transform[1]};
+        const glm::vec3 axis_z = glm::vec3{transform[2]};
+        const glm::vec3 extent = glm::abs(axis_x) * local_extent.x + glm::abs(axis_y) * local_extent.y + glm::abs(axis_z) * local_extent.z;
+        const float scale = glm::max(glm::length(axis_x), glm::max(glm::length(axis_y), glm::length(axis_z)));
+
+        center_x_[slot] = center.x;
+        center_y_[slot] = center.y;
+        center_z_[slot] = center.z;
+        extent_x_[slot] = extent.x;
+        extent_y_[slot] = extent.y;
+        extent_z_[slot] = extent.z;
+        radius_[slot] = model.getBoundingSphere().w * scale;
+    }
+
+    void LveFrustumCuller::runKernel(const LveFrustum& frustum)
+    {
+        // pad so the kernels can always load full registers, padded lanes are ignored
+        const size_t object_count = object_indices_.size();
+        const size_t padded_count = (object_count + KERNEL_PADDING - 1) / KERNEL_PADDING * KERNEL_PADDING;
+        for (auto* values : {&center_x_, &center_y_, &center_z_, &extent_x_, &extent_y_, &extent_z_, &radius_})
+        {
+            values->resize(padded_count, 0.0f);
+        }
+        visible_flags_.resize(padded_count);
+
+        PackedPlane planes[6];
+        for (size_t p = 0; p < 6; p++)
+        {
+            const glm::vec4& plane = frustum.planes[p];
+            planes[p] = {plane.x, plane.y, plane.z, plane.w, std::fabs(plane.x), std::fabs(plane.y), std::fabs(plane.z)};
+        }
+
+        // ranges are whole kernel blocks, every object (and its transform) belongs to exactly one
+        auto cull_blocks = [this, &planes, object_count](size_t first_block, size_t last_block)
+        {
+            const size_t begin = first_block * KERNEL_PADDING;
+            const size_t end = last_block * KERNEL_PADDING;
+            for (size_t slot = begin; slot < std::min(end, object_count); slot++)
+            {
+                packBounds(slot);
+            }
+
+            const PackedBounds bounds{center_x_.data() + begin, center_y_.data() + begin, center_z_.data() + begin,
+                extent_x_.data() + begin, extent_y_.data() + begin, extent_z_.data() + begin, radius_.data() + begin};
+            cullKernel(planes, bounds, end - begin, visible_flags_.data() + begin);
+        };
+
+        const size_t block_count = padded_count / KERNEL_PADDING;
+        if (job_system_ != nullptr)
+        {
+            job_system_->parallelFor(block_count, PARALLEL_RANGE_SIZE / KERNEL_PADDING, cull_blocks);
+        }
+        else
+        {
+            cull_blocks(0, block_count);
+        }
+
+        visible_slots_.clear();
+        for (size_t i = 0; i < object_count; i++)
+        {
+            if (visible_flags_[i])
+            {
+                visible_slots_.push_back(static_cast<uint32_t>(i));
+            }
+        }
+
+        tested_count_ = static_cast<uint32_t>(object_count);
+        visible_count_ = static_cast<uint32_t>(visible_slots_.size());
+    }
+
+    void LveFrustumCuller::cull(const LveFrustum& frustum, std::vector<LveGameObject>& game_objects, std::vector<uint32_t>& visible_objects)
+    {
+        LVE_CPU_ZONE("LveFrustumCuller::cull");
+        clearBounds();
+        for (size_t i = 0; i < game_objects.size(); i++)
+        {
+            if (game_objects[i].model_ != nullptr)
+            {
+                addBounds(static_cast<uint32_t>(i), game_objects[i].transform_, *game_objects[i].model_);
+            }
+        }
+        runKernel(frustum);
+
+        visible_objects.clear();
+        for (const uint32_t slot : visible_slots_)
+        {
+            visible_objects.push_back(object_indices_[slot]);
+        }
+    }
+
+    void LveFrustumCuller::cull(const LveFrustum& frustum, LveRegistry& registry, std::vector<LveEntity>& visible_entities)
+    {
+        LVE_CPU_ZONE("LveFrustumCuller::cull");
+        clearBounds();
+        entities_.clear();
+        registry.view<TransformComponent, RenderComponent>().each([this](LveEntity entity, TransformComponent& transform, RenderComponent& render)
+        {
+            if (render.model != nullptr)
+            {
+                addBounds(static_cast<uint32_t>(entities_.size()), transform, *render.model);
+                entities_.push_back(entity);
+            }
+        });
+        runKernel(frustum);
+
+        visible_entities.clear();
+        for (const uint32_t slot : visible_slots_)
+        {
+            visible_entities.push_back(entities_[object_indices_[slot]]);
+        }
+    }
+}
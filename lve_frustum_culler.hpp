@@ -0,0 +1,76 @@
+#pragma once
+
+#include "lve_frustum.hpp"
+#include "lve_game_object.hpp"
+#include "lve_registry.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace lve
+{
+    class LveJobSystem;
+
+    /**
+        CPU frustum culling of game objects against the bounding volumes of their models.
+        Bounds are transformed into world space and packed into structure of arrays form (box center and
+        half extents, sphere radius), then tested 8 (AVX), 4 (SSE/NEON) or 1 (scalar) at a time against
+        the six planes. An object is culled when either its box or its sphere is fully outside one plane.
+        The kernel is picked at compile time, build with -mavx to get the AVX one on x86.
+        With a job_system, transforming the bounds and running the kernel are split into ranges of
+        objects processed in parallel.
+    */
+    class LveFrustumCuller
+    {
+        public:
+            explicit LveFrustumCuller(LveJobSystem* job_system = nullptr) : job_system_{job_system} {}
+
+            // deleting copy operator and copy constructor
+            LveFrustumCuller(const LveFrustumCuller&) = delete;
+            LveFrustumCuller &operator=(const LveFrustumCuller&) = delete;
+
+            // replaces visible_objects with the indices of the game objects that intersect the frustum
+            void cull(const LveFrustum& frustum, std::vector<LveGameObject>& game_objects, std::vector<uint32_t>& visible_objects);
+
+            // same for the entities with a TransformComponent and a RenderComponent
+            void cull(const LveFrustum& frustum, LveRegistry& registry, std::vector<LveEntity>& visible_entities);
+
+            static const char* getKernelName();
+
+            uint32_t getTestedCount() const { return tested_count_; }
+            uint32_t getVisibleCount() const { return visible_count_; }
+
+        private:
+            struct BoundsSource
+            {
+                TransformComponent* transform;
+                const LveModel* model;
+            };
+
+            void clearBounds();
+            void addBounds(uint32_t object_index, TransformComponent& transform, const LveModel& model);
+            // transforms the bounds of the added object in the given slot into world space
+            void packBounds(size_t slot);
+            // tests everything added since clearBounds(), leaves the packed slots of visible objects in visible_slots_
+            void runKernel(const LveFrustum& frustum);
+
+            LveJobSystem* job_system_;
+
+            // world space bounds, padded to a multiple of the widest kernel
+            std::vector<float> center_x_;
+            std::vector<float> center_y_;
+            std::vector<float> center_z_;
+            std::vector<float> extent_x_;
+            std::vector<float> extent_y_;
+            std::vector<float> extent_z_;
+            std::vector<float> radius_;
+            std::vector<BoundsSource> bounds_sources_;
+            std::vector<uint32_t> object_indices_;   // packed slot -> game object index
+            std::vector<uint8_t> visible_flags_;
+            std::vector<uint32_t> visible_slots_;
+            std::vector<LveEntity> entities_;   // object index -> entity for the registry overload
+
+            uint32_t tested_count_ = 0;
+            uint32_t visible_count_ = 0;
+    };
+}
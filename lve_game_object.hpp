@@ -6,6 +6,7 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 // std
+#include <cstdint>
 #include <memory>
 
 namespace lve
@@ -16,12 +17,49 @@ namespace lve
         glm::vec3 scale{1.0f, 1.0f, 1.0f};
         glm::vec3 rotation{};
 
+        /**
+            Cached model matrix, only rebuilt when translation, scale or rotation changed since the last build.
+            Changes are detected by comparing against the values the cache was built from, so the fields
+            can still be written directly. Frames rebuild every changed matrix in one batch with
+            LveTransformStore::updateDirtyMatrices() before culling, the rebuild here is only the fallback.
+        */
+        const glm::mat4& mat4()
+        {
+            if (isDirty())
+            {
+                setMatrix(computeMatrix());
+            }
+            return matrix_;
+        }
+
+        // true when the fields changed since the cached matrix was built
+        bool isDirty() const
+        {
+            return version_ == 0 || translation != built_translation_ || scale != built_scale_ || rotation != built_rotation_;
+        }
+
+        // incremented whenever the cached matrix is rebuilt, 0 until the first build
+        uint32_t getVersion() const
+        {
+            return version_;
+        }
+
+        // stores a matrix built elsewhere (e.g. by LveTransformStore) from the current fields
+        void setMatrix(const glm::mat4& matrix)
+        {
+            matrix_ = matrix;
+            built_translation_ = translation;
+            built_scale_ = scale;
+            built_rotation_ = rotation;
+            version_++;
+        }
+
         /**
             Matrix corrsponds to Translate * Ry * Rx * Rz * Scale
             Rotations correspond to Tait-Bryan angles of Y(1), X(2), Z(3)
             https://en.wikipedia.org/wiki/Euler_angles#Rotation_matrix
         */
-        glm::mat4 mat4()
+        glm::mat4 computeMatrix() const
         {
             const float c3 = glm::cos(rotation.z);
             const float s3 = glm::sin(rotation.z);
@@ -58,6 +96,47 @@ namespace lve
                 }
             };
         }
+
+        private:
+            glm::mat4 matrix_{1.0f};
+            glm::vec3 built_translation_{};
+            glm::vec3 built_scale_{};
+            glm::vec3 built_rotation_{};
+            uint32_t version_ = 0;
+    };
+
+    /**
+        Simulated motion of an object, advanced in fixed steps by LveSimulation. Rendering never reads it
+        directly: after the steps of a frame, LveSimulation writes the interpolation of previous and current
+        into the object's TransformComponent.
+    */
+    struct SimulationComponent
+    {
+        struct State
+        {
+            glm::vec3 translation{};
+            glm::vec3 scale{1.0f, 1.0f, 1.0f};
+            glm::vec3 rotation{};
+        };
+
+        State previous{};   // before the last fixed step
+        State current{};
+        glm::vec3 velocity{};           // units per second
+        glm::vec3 angular_velocity{};   // radians per second around x, y and z
+
+        // at rest in the pose of transform
+        static SimulationComponent fromTransform(const TransformComponent& transform)
+        {
+            const State state{transform.translation, transform.scale, transform.rotation};
+            return SimulationComponent{state, state};
+        }
+    };
+
+    // what to draw for an entity of an LveRegistry, the transform is a separate TransformComponent
+    struct RenderComponent
+    {
+        std::shared_ptr<LveModel> model;
+        glm::vec3 color{};
     };
 
     class LveGameObject
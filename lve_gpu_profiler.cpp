@@ -0,0 +1,186 @@
+#include "lve_gpu_profiler.hpp"
+
+#include <cassert>
+#include <iterator>
+#include <stdexcept>
+
+namespace lve
+{
+    LveGpuProfiler::LveGpuProfiler(LveDevice& device, int frame_count, size_t history_length): lve_device_(device), queries_per_frame_(2 + 2 * MAX_ZONES_PER_FRAME), history_length_(history_length)
+    {
+        // timestamps need a non-zero period and valid bits on the graphics queue family
+        uint32_t queue_family_count = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(lve_device_.getPhysicalDevice(), &queue_family_count, nullptr);
+        std::vector<VkQueueFamilyProperties> queue_families(queue_family_count);
+        vkGetPhysicalDeviceQueueFamilyProperties(lve_device_.getPhysicalDevice(), &queue_family_count, queue_families.data());
+
+        const uint32_t valid_bits = queue_families[lve_device_.findPhysicalQueueFamilies().graphicsFamily].timestampValidBits;
+        timestamp_period_ns_ = lve_device_.properties.limits.timestampPeriod;
+        is_supported_ = valid_bits > 0 && timestamp_period_ns_ > 0.0;
+        timestamp_mask_ = valid_bits >= 64 ? ~0ull : (1ull << valid_bits) - 1;
+
+        frame_slots_.resize(frame_count);
+        if (!is_supported_)
+        {
+            return;
+        }
+
+        for (auto& slot : frame_slots_)
+        {
+            VkQueryPoolCreateInfo info{};
+            info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+            info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+            info.queryCount = queries_per_frame_;
+
+            if (vkCreateQueryPool(lve_device_.device(), &info, nullptr, &slot.query_pool) != VK_SUCCESS)
+            {
+                throw std::runtime_error("LveGpuProfiler::LveGpuProfiler(): failed to create timestamp query pool");
+            }
+            slot.zones.reserve(MAX_ZONES_PER_FRAME);
+        }
+        timestamps_.resize(queries_per_frame_);
+    }
+
+    LveGpuProfiler::~LveGpuProfiler()
+    {
+        for (auto& slot : frame_slots_)
+        {
+            if (slot.query_pool != VK_NULL_HANDLE)
+            {
+                vkDestroyQueryPool(lve_device_.device(), slot.query_pool, nullptr);
+            }
+        }
+    }
+
+    void LveGpuProfiler::beginFrame(VkCommandBuffer command_buffer, int frame_index)
+    {
+        if (!is_supported_)
+        {
+            return;
+        }
+
+        FrameSlot& slot = frame_slots_[frame_index];
+        if (slot.is_pending)
+        {
+            collectResults(slot);   // the in-flight fence of this slot has signaled, results are available
+        }
+
+        vkCmdResetQueryPool(command_buffer, slot.query_pool, 0, queries_per_frame_);
+        vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, slot.query_pool, 0);
+
+        slot.query_count = 2;   // query 0 and 1 are reserved for the frame itself
+        slot.zones.clear();
+        slot.frame_number = frame_number_++;
+        current_slot_ = &slot;
+        current_depth_ = 0;
+    }
+
+    void LveGpuProfiler::endFrame(VkCommandBuffer command_buffer)
+    {
+        if (current_slot_ == nullptr)
+        {
+            return;
+        }
+
+        assert(current_depth_ == 0 && "LveGpuProfiler::endFrame(): a zone was not closed");
+        vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, current_slot_->query_pool, 1);
+        current_slot_->is_pending = true;
+        current_slot_ = nullptr;
+    }
+
+    uint32_t LveGpuProfiler::beginZone(VkCommandBuffer command_buffer, const char* name)
+    {
+        if (current_slot_ == nullptr || current_slot_->zones.size() >= MAX_ZONES_PER_FRAME)
+        {
+            return INVALID_ZONE;
+        }
+
+        Zone zone{};
+        zone.name = name;
+        zone.depth = current_depth_++;
+        zone.begin_query = current_slot_->query_count++;
+        zone.end_query = current_slot_->query_count++;
+        vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, current_slot_->query_pool, zone.begin_query);
+
+        current_slot_->zones.push_back(zone);
+        return static_cast<uint32_t>(current_slot_->zones.size() - 1);
+    }
+
+    void LveGpuProfiler::endZone(VkCommandBuffer command_buffer, uint32_t zone)
+    {
+        if (current_slot_ == nullptr || zone == INVALID_ZONE)
+        {
+            return;
+        }
+
+        current_depth_--;
+        vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, current_slot_->query_pool, current_slot_->zones[zone].end_query);
+    }
+
+    void LveGpuProfiler::collectPendingResults()
+    {
+        for (auto& slot : frame_slots_)
+        {
+            if (slot.is_pending)
+            {
+                collectResults(slot);
+            }
+        }
+    }
+
+    void LveGpuProfiler::setHistoryLength(size_t history_length)
+    {
+        history_length_ = history_length;
+        while (history_.size() > history_length_)
+        {
+            history_.pop_front();
+        }
+    }
+
+    void LveGpuProfiler::collectResults(FrameSlot& slot)
+    {
+        slot.is_pending = false;
+
+        const VkResult result = vkGetQueryPoolResults(
+            lve_device_.device(),
+            slot.query_pool,
+            0,
+            slot.query_count,
+            slot.query_count * sizeof(uint64_t),
+            timestamps_.data(),
+            sizeof(uint64_t),
+            VK_QUERY_RESULT_64_BIT
+        );
+        if (result != VK_SUCCESS)
+        {
+            return;   // VK_NOT_READY should not happen once the fence signaled, drop the frame rather than stall
+        }
+
+        FrameResult frame_result{};
+        frame_result.frame_number = slot.frame_number;
+        frame_result.frame_milliseconds = ticksToMilliseconds(timestamps_[0], timestamps_[1]);
+        frame_result.zones.reserve(slot.zones.size());
+        for (const auto& zone : slot.zones)
+        {
+            frame_result.zones.push_back({zone.name, zone.depth, ticksToMilliseconds(timestamps_[zone.begin_query], timestamps_[zone.end_query])});
+        }
+
+        // slots are collected in submission order, except by collectPendingResults() which may see them out of order
+        auto position = history_.end();
+        while (position != history_.begin() && std::prev(position)->frame_number > frame_result.frame_number)
+        {
+            --position;
+        }
+        history_.insert(position, std::move(frame_result));
+        while (history_.size() > history_length_)
+        {
+            history_.pop_front();
+        }
+    }
+
+    double LveGpuProfiler::ticksToMilliseconds(uint64_t begin, uint64_t end) const
+    {
+        const uint64_t ticks = (end - begin) & timestamp_mask_;
+        return static_cast<double>(ticks) * timestamp_period_ns_ * 1e-6;
+    }
+}
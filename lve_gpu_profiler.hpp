@@ -0,0 +1,113 @@
+#pragma once
+
+#include "lve_device.hpp"
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace lve
+{
+    /**
+        GPU timestamp profiler with one query pool per frame in flight.
+        Queries of a frame are read back when its slot comes around again, i.e. after the in-flight
+        fence of that frame has been waited on, so reading results never stalls the CPU.
+        Zones can nest; zone names must outlive the profiler (string literals).
+    */
+    class LveGpuProfiler
+    {
+        public:
+            static constexpr uint32_t MAX_ZONES_PER_FRAME = 64;
+            static constexpr uint32_t INVALID_ZONE = UINT32_MAX;
+
+            struct ZoneResult
+            {
+                const char* name;
+                uint32_t depth;   // nesting level, 0 for top level zones
+                double milliseconds;
+            };
+
+            struct FrameResult
+            {
+                uint64_t frame_number = 0;
+                double frame_milliseconds = 0.0;   // from beginFrame() to endFrame() on the GPU timeline
+                std::vector<ZoneResult> zones{};
+            };
+
+            // RAII helper: LveGpuProfiler::ScopedZone zone{profiler, command_buffer, "SimpleRenderSystem"};
+            class ScopedZone
+            {
+                public:
+                    ScopedZone(LveGpuProfiler& profiler, VkCommandBuffer command_buffer, const char* name):
+                    profiler_(profiler), command_buffer_(command_buffer), zone_(profiler.beginZone(command_buffer, name)) {}
+                    ~ScopedZone() { profiler_.endZone(command_buffer_, zone_); }
+
+                    ScopedZone(const ScopedZone&) = delete;
+                    ScopedZone &operator=(const ScopedZone&) = delete;
+
+                private:
+                    LveGpuProfiler& profiler_;
+                    VkCommandBuffer command_buffer_;
+                    uint32_t zone_;
+            };
+
+            LveGpuProfiler(LveDevice& device, int frame_count, size_t history_length = 240);
+            ~LveGpuProfiler();
+
+            // deleting copy operator and copy constructor
+            LveGpuProfiler(const LveGpuProfiler&) = delete;
+            LveGpuProfiler &operator=(const LveGpuProfiler&) = delete;
+
+            bool isSupported() const { return is_supported_; }
+
+            // frame_index's in-flight fence must have signaled, LveRenderer calls these around each frame
+            void beginFrame(VkCommandBuffer command_buffer, int frame_index);
+            void endFrame(VkCommandBuffer command_buffer);
+
+            uint32_t beginZone(VkCommandBuffer command_buffer, const char* name);
+            void endZone(VkCommandBuffer command_buffer, uint32_t zone);
+
+            // reads every frame still pending, only call once the GPU is idle (e.g. after vkDeviceWaitIdle)
+            void collectPendingResults();
+
+            const std::deque<FrameResult>& getHistory() const { return history_; }
+            const FrameResult* getLatestResult() const { return history_.empty() ? nullptr : &history_.back(); }
+            void setHistoryLength(size_t history_length);
+
+        private:
+            struct Zone
+            {
+                const char* name;
+                uint32_t depth;
+                uint32_t begin_query;
+                uint32_t end_query;
+            };
+
+            struct FrameSlot
+            {
+                VkQueryPool query_pool = VK_NULL_HANDLE;
+                uint32_t query_count = 0;
+                std::vector<Zone> zones{};
+                uint64_t frame_number = 0;
+                bool is_pending = false;
+            };
+
+            void collectResults(FrameSlot& slot);
+            double ticksToMilliseconds(uint64_t begin, uint64_t end) const;
+
+            LveDevice& lve_device_;
+            bool is_supported_ = false;
+            double timestamp_period_ns_ = 0.0;
+            uint64_t timestamp_mask_ = ~0ull;
+            uint32_t queries_per_frame_;
+
+            std::vector<FrameSlot> frame_slots_;
+            FrameSlot* current_slot_ = nullptr;
+            uint32_t current_depth_ = 0;
+            uint64_t frame_number_ = 0;
+
+            std::vector<uint64_t> timestamps_;   // readback scratch
+            std::deque<FrameResult> history_;
+            size_t history_length_;
+    };
+}
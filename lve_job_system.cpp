@@ -0,0 +1,244 @@
+#include "lve_job_system.hpp"
+#include "lve_cpu_profiler.hpp"
+
+#include <cassert>
+#include <string>
+
+namespace lve
+{
+    thread_local LveJobSystem* LveJobSystem::thread_system_ = nullptr;
+    thread_local uint32_t LveJobSystem::thread_queue_index_ = 0;
+
+    bool LveJobSystem::WorkQueue::push(Job* job)
+    {
+        const int64_t bottom = bottom_.load(std::memory_order_relaxed);
+        const int64_t top = top_.load(std::memory_order_acquire);
+        if (bottom - top >= CAPACITY)
+        {
+            return false;
+        }
+        jobs_[bottom & (CAPACITY - 1)].store(job, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom_.store(bottom + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    LveJobSystem::Job* LveJobSystem::WorkQueue::pop()
+    {
+        const int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+        bottom_.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t top = top_.load(std::memory_order_relaxed);
+        if (top > bottom)
+        {
+            bottom_.store(bottom + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        Job* job = jobs_[bottom & (CAPACITY - 1)].load(std::memory_order_relaxed);
+        if (top == bottom)
+        {
+            // last job, race the thieves for it
+            if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            {
+                job = nullptr;
+            }
+            bottom_.store(bottom + 1, std::memory_order_relaxed);
+        }
+        return job;
+    }
+
+    LveJobSystem::Job* LveJobSystem::WorkQueue::steal()
+    {
+        int64_t top = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const int64_t bottom = bottom_.load(std::memory_order_acquire);
+        if (top >= bottom)
+        {
+            return nullptr;
+        }
+
+        Job* job = jobs_[top & (CAPACITY - 1)].load(std::memory_order_relaxed);
+        if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        {
+            return nullptr;
+        }
+        return job;
+    }
+
+    uint32_t LveJobSystem::getDefaultWorkerCount()
+    {
+        const uint32_t hardware_threads = std::thread::hardware_concurrency();
+        return hardware_threads > 1 ? hardware_threads - 1 : 0;
+    }
+
+    LveJobSystem::LveJobSystem(uint32_t worker_count)
+    {
+        for (uint32_t i = 0; i <= worker_count; i++)
+        {
+            queues_.push_back(std::make_unique<WorkQueue>());
+        }
+
+        // a thread can only own a deque in one system, later systems created on it use the shared queue
+        if (thread_system_ == nullptr)
+        {
+            thread_system_ = this;
+            thread_queue_index_ = 0;
+        }
+
+        workers_.reserve(worker_count);
+        for (uint32_t i = 0; i < worker_count; i++)
+        {
+            workers_.emplace_back([this, i]() { workerLoop(i + 1); });
+        }
+    }
+
+    LveJobSystem::~LveJobSystem()
+    {
+        assert(queued_jobs_.load() == 0 && "LveJobSystem destroyed with jobs still queued");
+        {
+            std::lock_guard<std::mutex> lock{sleep_mutex_};
+            is_stopping_ = true;
+        }
+        wake_condition_.notify_all();
+        for (auto& worker : workers_)
+        {
+            worker.join();
+        }
+
+        if (thread_system_ == this)
+        {
+            thread_system_ = nullptr;
+        }
+    }
+
+    void LveJobSystem::run(LveJobCounter& counter, std::function<void()> function)
+    {
+        counter.pending_.fetch_add(1, std::memory_order_relaxed);
+        Job* job = new Job{std::move(function), &counter};
+
+        queued_jobs_.fetch_add(1);
+        if (thread_system_ == this)
+        {
+            if (!queues_[thread_queue_index_]->push(job))
+            {
+                // deque full, the caller does the work itself
+                queued_jobs_.fetch_sub(1);
+                execute(job);
+                return;
+            }
+        }
+        else
+        {
+            std::lock_guard<std::mutex> lock{shared_mutex_};
+            shared_jobs_.push_back(job);
+        }
+
+        if (sleeping_workers_.load() > 0)
+        {
+            std::lock_guard<std::mutex> lock{sleep_mutex_};
+            wake_condition_.notify_one();
+        }
+    }
+
+    void LveJobSystem::wait(LveJobCounter& counter)
+    {
+        LVE_CPU_ZONE("LveJobSystem::wait");
+        while (!counter.isDone())
+        {
+            if (Job* job = findJob())
+            {
+                execute(job);
+            }
+            else
+            {
+                // the remaining jobs are running on other threads
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    void LveJobSystem::workerLoop(uint32_t queue_index)
+    {
+        thread_system_ = this;
+        thread_queue_index_ = queue_index;
+        LveCpuProfiler::get().setThreadName("Job worker " + std::to_string(queue_index));
+
+        while (true)
+        {
+            if (Job* job = findJob())
+            {
+                execute(job);
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock{sleep_mutex_};
+            sleeping_workers_.fetch_add(1);
+            wake_condition_.wait(lock, [this]() { return is_stopping_ || queued_jobs_.load() > 0; });
+            sleeping_workers_.fetch_sub(1);
+            if (is_stopping_)
+            {
+                return;
+            }
+        }
+    }
+
+    LveJobSystem::Job* LveJobSystem::findJob()
+    {
+        const bool owns_queue = thread_system_ == this;
+        if (owns_queue)
+        {
+            if (Job* job = queues_[thread_queue_index_]->pop())
+            {
+                queued_jobs_.fetch_sub(1);
+                return job;
+            }
+        }
+        if (queued_jobs_.load() <= 0)
+        {
+            return nullptr;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock{shared_mutex_};
+            if (!shared_jobs_.empty())
+            {
+                Job* job = shared_jobs_.back();
+                shared_jobs_.pop_back();
+                queued_jobs_.fetch_sub(1);
+                return job;
+            }
+        }
+
+        // victims are visited starting at a per-thread random offset so thieves spread out
+        thread_local uint32_t random_state = static_cast<uint32_t>(std::hash<std::thread::id>{}(std::this_thread::get_id())) | 1u;
+        random_state ^= random_state << 13;
+        random_state ^= random_state >> 17;
+        random_state ^= random_state << 5;
+        const size_t queue_count = queues_.size();
+        for (size_t i = 0; i < queue_count; i++)
+        {
+            const size_t victim = (random_state + i) % queue_count;
+            if (owns_queue && victim == thread_queue_index_)
+            {
+                continue;
+            }
+            if (Job* job = queues_[victim]->steal())
+            {
+                queued_jobs_.fetch_sub(1);
+                return job;
+            }
+        }
+        return nullptr;
+    }
+
+    void LveJobSystem::execute(Job* job)
+    {
+        job->function();
+
+        // the waiter may destroy the counter as soon as it reaches zero
+        LveJobCounter* counter = job->counter;
+        delete job;
+        counter->pending_.fetch_sub(1, std::memory_order_acq_rel);
+    }
+}
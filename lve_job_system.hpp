@@ -0,0 +1,133 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace lve
+{
+    // number of jobs started with it that have not finished yet, see LveJobSystem::wait()
+    class LveJobCounter
+    {
+        public:
+            bool isDone() const { return pending_.load(std::memory_order_acquire) == 0; }
+
+        private:
+            friend class LveJobSystem;
+
+            std::atomic<uint32_t> pending_{0};
+    };
+
+    /**
+        Work-stealing task scheduler. Every worker thread, and the thread that created the system, owns a
+        Chase-Lev deque: the owner pushes and pops at the bottom without locks, idle threads steal from the
+        top of the others. Other threads submit through a mutex protected queue. Jobs report completion
+        to an LveJobCounter and wait() executes jobs itself until the counter drops to zero, so waiting
+        inside a job cannot deadlock. Idle workers sleep on a condition variable.
+    */
+    class LveJobSystem
+    {
+        public:
+            // one worker per remaining hardware thread, the creating thread works while it waits
+            static uint32_t getDefaultWorkerCount();
+
+            explicit LveJobSystem(uint32_t worker_count = getDefaultWorkerCount());
+            // all jobs have to be waited for before destruction
+            ~LveJobSystem();
+
+            // deleting copy operator and copy constructor
+            LveJobSystem(const LveJobSystem&) = delete;
+            LveJobSystem &operator=(const LveJobSystem&) = delete;
+
+            void run(LveJobCounter& counter, std::function<void()> function);
+            // executes queued jobs on the calling thread until counter is done
+            void wait(LveJobCounter& counter);
+
+            /**
+                Calls function(begin, end) for disjoint ranges covering [0, count), each at least
+                min_range_size long (except a shorter last one), and returns when all of them finished.
+                Runs inline when the work is too small to split.
+            */
+            template<typename Function>
+            void parallelFor(size_t count, size_t min_range_size, const Function& function)
+            {
+                const size_t max_ranges = std::max<size_t>(1, count / std::max<size_t>(1, min_range_size));
+                const size_t range_count = std::min(max_ranges, static_cast<size_t>(getWorkerCount() + 1) * RANGES_PER_THREAD);
+                if (range_count <= 1)
+                {
+                    function(size_t{0}, count);
+                    return;
+                }
+
+                LveJobCounter counter{};
+                const size_t range_size = (count + range_count - 1) / range_count;
+                for (size_t begin = range_size; begin < count; begin += range_size)
+                {
+                    const size_t end = std::min(count, begin + range_size);
+                    run(counter, [&function, begin, end]() { function(begin, end); });
+                }
+                function(size_t{0}, std::min(count, range_size));
+                wait(counter);
+            }
+
+            uint32_t getWorkerCount() const { return static_cast<uint32_t>(workers_.size()); }
+
+        private:
+            // ranges per thread of parallelFor(), more than one so stealing can even out uneven ranges
+            static constexpr size_t RANGES_PER_THREAD = 4;
+
+            struct Job
+            {
+                std::function<void()> function;
+                LveJobCounter* counter;
+            };
+
+            // Chase-Lev deque (Le et al., "Correct and Efficient Work-Stealing for Weak Memory Models"), fixed capacity
+            class WorkQueue
+            {
+                public:
+                    static constexpr int64_t CAPACITY = 4096;   // power of two
+
+                    // owner only, false when full
+                    bool push(Job* job);
+                    // owner only, nullptr when empty
+                    Job* pop();
+                    // any thread, nullptr when empty or when another thread won the race
+                    Job* steal();
+
+                private:
+                    alignas(64) std::atomic<int64_t> top_{0};
+                    alignas(64) std::atomic<int64_t> bottom_{0};
+                    alignas(64) std::atomic<Job*> jobs_[CAPACITY]{};
+            };
+
+            void workerLoop(uint32_t queue_index);
+            // own deque first, then the shared queue, then stealing
+            Job* findJob();
+            void execute(Job* job);
+
+            std::vector<std::unique_ptr<WorkQueue>> queues_;   // 0 belongs to the creating thread, i + 1 to worker i
+            std::vector<std::thread> workers_;
+
+            std::mutex shared_mutex_;
+            std::vector<Job*> shared_jobs_;   // submitted by threads without a deque
+
+            // queued_jobs_ is raised before a job becomes visible, so a sleeping worker never misses one
+            std::atomic<int64_t> queued_jobs_{0};
+            std::atomic<uint32_t> sleeping_workers_{0};
+            std::mutex sleep_mutex_;
+            std::condition_variable wake_condition_;
+            bool is_stopping_ = false;   // guarded by sleep_mutex_
+
+            // deque of the calling thread in the system it belongs to
+            static thread_local LveJobSystem* thread_system_;
+            static thread_local uint32_t thread_queue_index_;
+    };
+}
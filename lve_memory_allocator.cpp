@@ -0,0 +1,266 @@
+#include "lve_memory_allocator.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace lve
+{
+    struct LveMemoryBlock
+    {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize size = 0;
+        uint32_t memory_type_index = 0;
+        void* mapped = nullptr;
+        std::map<VkDeviceSize, VkDeviceSize> free_ranges{};   // offset -> size, sorted by offset
+        VkDeviceSize bytes_used = 0;
+        uint32_t allocation_count = 0;
+    };
+
+    namespace
+    {
+        VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+        {
+            return (value + alignment - 1) & ~(alignment - 1);
+        }
+    }
+
+    LveMemoryAllocator::LveMemoryAllocator(VkDevice device, VkPhysicalDevice physical_device, VkDeviceSize block_size): device_(device), block_size_(block_size)
+    {
+        vkGetPhysicalDeviceMemoryProperties(physical_device, &memory_properties_);
+
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(physical_device, &properties);
+        buffer_image_granularity_ = properties.limits.bufferImageGranularity;
+        max_allocation_count_ = properties.limits.maxMemoryAllocationCount;
+
+        blocks_.resize(memory_properties_.memoryTypeCount);
+    }
+
+    LveMemoryAllocator::~LveMemoryAllocator()
+    {
+        for (auto& type_blocks : blocks_)
+        {
+            for (auto& block : type_blocks)
+            {
+                assert(block->allocation_count == 0 && "LveMemoryAllocator destroyed while allocations are still alive");
+                destroyBlock(*block);
+            }
+        }
+    }
+
+    LveAllocation LveMemoryAllocator::allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool linear_resource)
+    {
+        // optimal-tiling images must not share a bufferImageGranularity page with linear resources,
+        // padding both ends of every image to that granularity keeps neighbours on separate pages
+        VkDeviceSize alignment = std::max<VkDeviceSize>(requirements.alignment, 1);
+        VkDeviceSize size = requirements.size;
+        if (!linear_resource)
+        {
+            alignment = std::max(alignment, buffer_image_granularity_);
+            size = alignUp(size, buffer_image_granularity_);
+        }
+
+        std::lock_guard<std::mutex> lock{mutex_};
+
+        for (uint32_t type_index = 0; type_index < memory_properties_.memoryTypeCount; type_index++)
+        {
+            const bool type_allowed = requirements.memoryTypeBits & (1u << type_index);
+            const bool has_properties = (memory_properties_.memoryTypes[type_index].propertyFlags & properties) == properties;
+            if (!type_allowed || !has_properties)
+            {
+                continue;
+            }
+
+            LveAllocation allocation{};
+            for (auto& block : blocks_[type_index])
+            {
+                if (tryAllocateFromBlock(*block, size, alignment, allocation))
+                {
+                    return allocation;
+                }
+            }
+
+            // resources bigger than half a block get a block of their own instead of wasting the remainder
+            const VkDeviceSize new_block_size = size > block_size_ / 2 ? size : block_size_;
+            if (device_allocation_count_ >= max_allocation_count_)
+            {
+                throw std::runtime_error("LveMemoryAllocator::allocate(): maxMemoryAllocationCount reached");
+            }
+
+            LveMemoryBlock* block = nullptr;
+            try
+            {
+                block = &createBlock(type_index, new_block_size);
+            }
+            catch (const std::runtime_error&)
+            {
+                continue;   // heap of this memory type is exhausted, try the next compatible type
+            }
+
+            if (tryAllocateFromBlock(*block, size, alignment, allocation))
+            {
+                return allocation;
+            }
+        }
+
+        throw std::runtime_error("LveMemoryAllocator::allocate(): failed to find suitable memory type");
+    }
+
+    void LveMemoryAllocator::free(LveAllocation& allocation)
+    {
+        if (allocation.block == nullptr)
+        {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock{mutex_};
+
+        LveMemoryBlock& block = *allocation.block;
+        VkDeviceSize offset = allocation.offset;
+        VkDeviceSize size = allocation.size;
+
+        // coalesce with the free range that follows...
+        auto next = block.free_ranges.lower_bound(offset);
+        if (next != block.free_ranges.end() && offset + size == next->first)
+        {
+            size += next->second;
+            next = block.free_ranges.erase(next);
+        }
+
+        // ...and with the one that precedes
+        if (next != block.free_ranges.begin())
+        {
+            auto previous = std::prev(next);
+            if (previous->first + previous->second == offset)
+            {
+                offset = previous->first;
+                size += previous->second;
+                block.free_ranges.erase(previous);
+            }
+        }
+        block.free_ranges.emplace(offset, size);
+
+        block.bytes_used -= allocation.size;
+        block.allocation_count--;
+
+        // keep one block per memory type around so load/unload churn does not hit vkAllocateMemory
+        auto& type_blocks = blocks_[block.memory_type_index];
+        if (block.allocation_count == 0 && type_blocks.size() > 1)
+        {
+            destroyBlock(block);
+            type_blocks.erase(std::find_if(type_blocks.begin(), type_blocks.end(), [&block](const auto& b) { return b.get() == &block; }));
+        }
+
+        allocation = LveAllocation{};
+    }
+
+    LveMemoryAllocator::Stats LveMemoryAllocator::getStats()
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+
+        Stats stats{};
+        for (const auto& type_blocks : blocks_)
+        {
+            for (const auto& block : type_blocks)
+            {
+                stats.block_count++;
+                stats.allocation_count += block->allocation_count;
+                stats.bytes_reserved += block->size;
+                stats.bytes_used += block->bytes_used;
+                stats.free_range_count += static_cast<uint32_t>(block->free_ranges.size());
+                VkDeviceSize block_largest_free_range = 0;
+                for (const auto& range : block->free_ranges)
+                {
+                    block_largest_free_range = std::max(block_largest_free_range, range.second);
+                }
+                stats.largest_free_range = std::max(stats.largest_free_range, block_largest_free_range);
+                stats.largest_free_range_sum += block_largest_free_range;
+            }
+        }
+        return stats;
+    }
+
+    bool LveMemoryAllocator::tryAllocateFromBlock(LveMemoryBlock& block, VkDeviceSize size, VkDeviceSize alignment, LveAllocation& allocation)
+    {
+        // first fit over the offset-sorted free list
+        for (auto it = block.free_ranges.begin(); it != block.free_ranges.end(); ++it)
+        {
+            const VkDeviceSize range_offset = it->first;
+            const VkDeviceSize range_size = it->second;
+            const VkDeviceSize aligned_offset = alignUp(range_offset, alignment);
+            const VkDeviceSize padding = aligned_offset - range_offset;
+            if (padding + size > range_size)
+            {
+                continue;
+            }
+
+            block.free_ranges.erase(it);
+            if (padding > 0)
+            {
+                block.free_ranges.emplace(range_offset, padding);
+            }
+            const VkDeviceSize remainder = range_size - padding - size;
+            if (remainder > 0)
+            {
+                block.free_ranges.emplace(aligned_offset + size, remainder);
+            }
+
+            block.bytes_used += size;
+            block.allocation_count++;
+
+            allocation.memory = block.memory;
+            allocation.offset = aligned_offset;
+            allocation.size = size;
+            allocation.mapped = block.mapped == nullptr ? nullptr : static_cast<char*>(block.mapped) + aligned_offset;
+            allocation.memory_type_index = block.memory_type_index;
+            allocation.block = &block;
+            return true;
+        }
+        return false;
+    }
+
+    LveMemoryBlock& LveMemoryAllocator::createBlock(uint32_t memory_type_index, VkDeviceSize size)
+    {
+        auto block = std::make_unique<LveMemoryBlock>();
+        block->size = size;
+        block->memory_type_index = memory_type_index;
+
+        VkMemoryAllocateInfo alloc_info{};
+        alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        alloc_info.allocationSize = size;
+        alloc_info.memoryTypeIndex = memory_type_index;
+
+        if (vkAllocateMemory(device_, &alloc_info, nullptr, &block->memory) != VK_SUCCESS)
+        {
+            throw std::runtime_error("LveMemoryAllocator::createBlock(): failed to allocate device memory");
+        }
+        device_allocation_count_++;
+
+        // a VkDeviceMemory can only be mapped once, so host visible blocks are mapped up front and shared
+        if (memory_properties_.memoryTypes[memory_type_index].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+        {
+            if (vkMapMemory(device_, block->memory, 0, VK_WHOLE_SIZE, 0, &block->mapped) != VK_SUCCESS)
+            {
+                vkFreeMemory(device_, block->memory, nullptr);
+                device_allocation_count_--;
+                throw std::runtime_error("LveMemoryAllocator::createBlock(): failed to map device memory");
+            }
+        }
+
+        block->free_ranges.emplace(0, size);
+
+        blocks_[memory_type_index].push_back(std::move(block));
+        return *blocks_[memory_type_index].back();
+    }
+
+    void LveMemoryAllocator::destroyBlock(LveMemoryBlock& block)
+    {
+        if (block.mapped != nullptr)
+        {
+            vkUnmapMemory(device_, block.memory);
+        }
+        vkFreeMemory(device_, block.memory, nullptr);
+        device_allocation_count_--;
+    }
+}
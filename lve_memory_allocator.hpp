@@ -0,0 +1,82 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace lve
+{
+    struct LveMemoryBlock;
+
+    // a sub-range of a larger VkDeviceMemory block, bind resources with (memory, offset)
+    struct LveAllocation
+    {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;
+        VkDeviceSize size = 0;
+        void* mapped = nullptr;   // non-null for host visible memory, blocks stay mapped for their lifetime
+        uint32_t memory_type_index = 0;
+        LveMemoryBlock* block = nullptr;
+    };
+
+    /**
+        Carves buffers and images out of large per-memory-type VkDeviceMemory blocks so the number of
+        vkAllocateMemory calls stays far below maxMemoryAllocationCount.
+        Every block keeps an offset-sorted free list, freed ranges are coalesced with their neighbours
+        and fully empty blocks are released (except the last one of each memory type).
+    */
+    class LveMemoryAllocator
+    {
+        public:
+            static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64 * 1024 * 1024;
+
+            struct Stats
+            {
+                uint32_t block_count = 0;
+                uint32_t allocation_count = 0;
+                VkDeviceSize bytes_reserved = 0;      // sum of all block sizes
+                VkDeviceSize bytes_used = 0;
+                uint32_t free_range_count = 0;
+                VkDeviceSize largest_free_range = 0;       // over all blocks
+                VkDeviceSize largest_free_range_sum = 0;   // of every block's largest free range
+
+                // 0 when all free memory is one contiguous range per block, approaches 1 as it splinters
+                float fragmentation() const
+                {
+                    const VkDeviceSize bytes_free = bytes_reserved - bytes_used;
+                    return bytes_free == 0 ? 0.0f : 1.0f - static_cast<float>(largest_free_range_sum) / static_cast<float>(bytes_free);
+                }
+            };
+
+            LveMemoryAllocator(VkDevice device, VkPhysicalDevice physical_device, VkDeviceSize block_size = DEFAULT_BLOCK_SIZE);
+            ~LveMemoryAllocator();
+
+            // deleting copy operator and copy constructor
+            LveMemoryAllocator(const LveMemoryAllocator&) = delete;
+            LveMemoryAllocator &operator=(const LveMemoryAllocator&) = delete;
+
+            // linear_resource is true for buffers and linear images, false for optimal-tiling images
+            LveAllocation allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool linear_resource);
+            void free(LveAllocation& allocation);
+
+            Stats getStats();
+
+        private:
+            bool tryAllocateFromBlock(LveMemoryBlock& block, VkDeviceSize size, VkDeviceSize alignment, LveAllocation& allocation);
+            LveMemoryBlock& createBlock(uint32_t memory_type_index, VkDeviceSize size);
+            void destroyBlock(LveMemoryBlock& block);
+
+            VkDevice device_;
+            VkPhysicalDeviceMemoryProperties memory_properties_;
+            VkDeviceSize buffer_image_granularity_;
+            uint32_t max_allocation_count_;
+            VkDeviceSize block_size_;
+
+            std::mutex mutex_;
+            uint32_t device_allocation_count_ = 0;   // number of live vkAllocateMemory allocations
+            std::vector<std::vector<std::unique_ptr<LveMemoryBlock>>> blocks_;   // indexed by memory type
+    };
+}
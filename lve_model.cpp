@@ -2,9 +2,33 @@
 
 #include <cassert>
 #include <cstring>
+#include <functional>
+#include <limits>
+#include <unordered_map>
 
 namespace lve
 {
+    namespace
+    {
+        struct VertexHasher
+        {
+            std::size_t operator()(const LveModel::Vertex& vertex) const
+            {
+                const float values[] = {
+                    vertex.position.x, vertex.position.y, vertex.position.z,
+                    vertex.color.x, vertex.color.y, vertex.color.z
+                };
+
+                std::size_t seed = 0;
+                for (const float value : values)
+                {
+                    seed ^= std::hash<float>{}(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);  // boost::hash_combine
+                }
+                return seed;
+            }
+        };
+    }
+
     std::vector<VkVertexInputBindingDescription> LveModel::Vertex::getBindingDescriptions()
     {
         std::vector<VkVertexInputBindingDescription> binding_descriptions(1);
@@ -28,53 +52,225 @@ namespace lve
         return attribute_descriptions;
     }
 
-    LveModel::LveModel(LveDevice& device, const std::vector<Vertex>& vertices): lve_device_{device}
+    LveModel::LveModel(LveDevice& device, const std::vector<Vertex>& vertices, MemoryMode memory_mode): lve_device_{device}, memory_mode_{memory_mode}
     {
         createVertexBuffers(vertices);
+        upload_ticket_ = lve_device_.uploadQueue().pendingTicket();
+    }
+
+    LveModel::LveModel(LveDevice& device, const Builder& builder, MemoryMode memory_mode): lve_device_{device}, memory_mode_{memory_mode}
+    {
+        createVertexBuffers(builder.vertices);
+        createIndexBuffers(builder.indices);
+        upload_ticket_ = lve_device_.uploadQueue().pendingTicket();
+    }
+
+    void LveModel::Builder::loadTriangleList(const std::vector<Vertex>& triangle_list)
+    {
+        vertices.clear();
+        indices.clear();
+        indices.reserve(triangle_list.size());
+
+        std::unordered_map<Vertex, uint32_t, VertexHasher> unique_vertices{};
+        for (const auto& vertex : triangle_list)
+        {
+            auto inserted = unique_vertices.emplace(vertex, static_cast<uint32_t>(vertices.size()));
+            if (inserted.second)
+            {
+                vertices.push_back(vertex);
+            }
+            indices.push_back(inserted.first->second);
+        }
     }
 
     LveModel::~LveModel()
     {
-        vkDestroyBuffer(lve_device_.device(), vertex_buffer_, nullptr);
-        vkFreeMemory(lve_device_.device(), verterx_buffer_memory_, nullptr);
+        lve_device_.destroyBuffer(vertex_buffer_, vertex_buffer_allocation_);
+
+        if (has_index_buffer_)
+        {
+            lve_device_.destroyBuffer(index_buffer_, index_buffer_allocation_);
+        }
     }
 
     void LveModel::bind(VkCommandBuffer command_buffer)
     {
         VkBuffer buffers[] = {vertex_buffer_};
-        VkDeviceSize offsets[] = {0};
+        VkDeviceSize offsets[] = {vertex_region_offset_};
         constexpr uint32_t first_binding = 0;
         constexpr uint32_t binding_count = 1;
         vkCmdBindVertexBuffers(command_buffer, first_binding, binding_count, buffers, offsets);
+
+        if (has_index_buffer_)
+        {
+            vkCmdBindIndexBuffer(command_buffer, index_buffer_, 0, index_type_);
+        }
     }
 
-    void LveModel::draw(VkCommandBuffer command_buffer)
+    void LveModel::draw(VkCommandBuffer command_buffer, uint32_t instance_count, uint32_t first_instance)
     {
-        constexpr uint32_t instance_count = 1;
         constexpr uint32_t first_vertex = 0;
-        constexpr uint32_t first_instance = 0;
-        vkCmdDraw(command_buffer, vertex_count_, instance_count, first_vertex, first_instance);
+        if (has_index_buffer_)
+        {
+            constexpr uint32_t first_index = 0;
+            constexpr int32_t vertex_offset = 0;
+            vkCmdDrawIndexed(command_buffer, index_count_, instance_count, first_index, vertex_offset, first_instance);
+        }
+        else
+        {
+            vkCmdDraw(command_buffer, vertex_count_, instance_count, first_vertex, first_instance);
+        }
+    }
+
+    bool LveModel::isUploaded()
+    {
+        if (!is_uploaded_)
+        {
+            is_uploaded_ = lve_device_.uploadQueue().isComplete(upload_ticket_);
+        }
+        return is_uploaded_;
+    }
+
+    void LveModel::writeVertices(int frame_index, const std::vector<Vertex>& vertices)
+    {
+        assert(memory_mode_ == MemoryMode::HostVisible && "LveModel::writeVertices() requires MemoryMode::HostVisible");
+        assert(vertices.size() == vertex_count_ && "LveModel::writeVertices() cannot change the vertex count");
+        assert(frame_index >= 0 && frame_index < LveSwapChain::MAX_FRAMES_IN_FLIGHT && "LveModel::writeVertices(): frame index out of range");
+
+        // never the region a previous frame still in flight was recorded with
+        vertex_region_offset_ = vertex_region_size_ * frame_index;
+        memcpy(static_cast<char*>(mapped_vertices_) + vertex_region_offset_, vertices.data(), static_cast<size_t>(vertex_region_size_));
+        computeBounds(vertices);
+    }
+
+    void LveModel::drawIndirect(VkCommandBuffer command_buffer, VkBuffer buffer, VkDeviceSize offset)
+    {
+        constexpr uint32_t draw_count = 1;
+        if (has_index_buffer_)
+        {
+            vkCmdDrawIndexedIndirect(command_buffer, buffer, offset, draw_count, sizeof(VkDrawIndexedIndirectCommand));
+        }
+        else
+        {
+            vkCmdDrawIndirect(command_buffer, buffer, offset, draw_count, sizeof(VkDrawIndirectCommand));
+        }
+    }
+
+    void LveModel::computeBounds(const std::vector<Vertex>& vertices)
+    {
+        // sphere around the center of the axis aligned box, not minimal but cheap and stable
+        glm::vec3 min_corner = vertices[0].position;
+        glm::vec3 max_corner = vertices[0].position;
+        for (const auto& vertex : vertices)
+        {
+            min_corner = glm::min(min_corner, vertex.position);
+            max_corner = glm::max(max_corner, vertex.position);
+        }
+
+        const glm::vec3 center = 0.5f * (min_corner + max_corner);
+        float radius_squared = 0.0f;
+        for (const auto& vertex : vertices)
+        {
+            const glm::vec3 offset = vertex.position - center;
+            radius_squared = glm::max(radius_squared, glm::dot(offset, offset));
+        }
+        bounding_sphere_ = glm::vec4{center, glm::sqrt(radius_squared)};
+        bounding_box_min_ = min_corner;
+        bounding_box_max_ = max_corner;
     }
 
     void LveModel::createVertexBuffers(const std::vector<Vertex>& vertices)
     {
         vertex_count_ = static_cast<uint32_t>(vertices.size());
         assert(vertex_count_ >= 3 && "LveModel::createVertexBuffers() expects a minimum of 3 vertices");
+        computeBounds(vertices);
 
         VkDeviceSize buffer_size = sizeof(vertices[0]) * vertex_count_;   // number of bytes
+        if (memory_mode_ == MemoryMode::HostVisible)
+        {
+            createHostVisibleVertexBuffer(vertices, buffer_size);
+        }
+        else
+        {
+            createDeviceLocalVertexBuffer(vertices, buffer_size);
+        }
+    }
+
+    void LveModel::createDeviceLocalVertexBuffer(const std::vector<Vertex>& vertices, VkDeviceSize buffer_size)
+    {
+        createDeviceLocalBuffer(vertices.data(), buffer_size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, vertex_buffer_, vertex_buffer_allocation_);
+    }
+
+    void LveModel::createHostVisibleVertexBuffer(const std::vector<Vertex>& vertices, VkDeviceSize buffer_size)
+    {
+        // vertex_region_size_ stays a multiple of sizeof(Vertex), every region offset is aligned for the attributes
+        vertex_region_size_ = buffer_size;
         lve_device_.createBuffer(
-            buffer_size,
+            vertex_region_size_ * LveSwapChain::MAX_FRAMES_IN_FLIGHT,
             VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,   // host is CPU, device is GPU
             vertex_buffer_,
-            verterx_buffer_memory_
+            vertex_buffer_allocation_
+        );
+
+        // host visible allocations stay mapped for their lifetime so writeVertices() is a plain memcpy;
+        // every region starts with the initial vertices, so the model can be drawn before the first write
+        mapped_vertices_ = vertex_buffer_allocation_.mapped;
+        for (int frame_index = 0; frame_index < LveSwapChain::MAX_FRAMES_IN_FLIGHT; frame_index++)
+        {
+            memcpy(static_cast<char*>(mapped_vertices_) + vertex_region_size_ * frame_index, vertices.data(), static_cast<size_t>(vertex_region_size_));
+        }
+    }
+
+    void LveModel::createIndexBuffers(const std::vector<uint32_t>& indices)
+    {
+        index_count_ = static_cast<uint32_t>(indices.size());
+        has_index_buffer_ = index_count_ > 0;
+        if (!has_index_buffer_)
+        {
+            return;
+        }
+
+        // 16-bit indices halve the index buffer whenever every vertex is addressable by them
+        if (vertex_count_ <= std::numeric_limits<uint16_t>::max())
+        {
+            std::vector<uint16_t> indices_16(indices.begin(), indices.end());
+            index_type_ = VK_INDEX_TYPE_UINT16;
+            createDeviceLocalBuffer(indices_16.data(), sizeof(indices_16[0]) * index_count_, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, index_buffer_, index_buffer_allocation_);
+        }
+        else
+        {
+            index_type_ = VK_INDEX_TYPE_UINT32;
+            createDeviceLocalBuffer(indices.data(), sizeof(indices[0]) * index_count_, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, index_buffer_, index_buffer_allocation_);
+        }
+    }
+
+    void LveModel::createDeviceLocalBuffer(const void* data, VkDeviceSize buffer_size, VkBufferUsageFlags usage, VkBuffer& buffer, LveAllocation& buffer_allocation)
+    {
+        // CPU writes into a host visible staging buffer, the upload queue copies it into device local memory
+        // and frees the staging buffer once the copy has completed
+        VkBuffer staging_buffer;
+        LveAllocation staging_buffer_allocation;
+        lve_device_.createBuffer(
+            buffer_size,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            staging_buffer,
+            staging_buffer_allocation
+        );
+
+        memcpy(staging_buffer_allocation.mapped, data, static_cast<size_t>(buffer_size));
+
+        lve_device_.createBuffer(
+            buffer_size,
+            usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            buffer,
+            buffer_allocation
         );
 
-        void *data;
-        constexpr VkDeviceSize offset = 0;
-        constexpr VkMemoryMapFlags mem_map_flags = 0;
-        vkMapMemory(lve_device_.device(), verterx_buffer_memory_, offset, buffer_size, mem_map_flags, &data);  // maps host memory (CPU) to device memory (GPU)
-        memcpy(data, vertices.data(), static_cast<size_t>(buffer_size));
-        vkUnmapMemory(lve_device_.device(), verterx_buffer_memory_);
+        LveUploadQueue& upload_queue = lve_device_.uploadQueue();
+        upload_queue.copyBuffer(staging_buffer, buffer, buffer_size);
+        upload_queue.releaseAfterUpload(staging_buffer, staging_buffer_allocation);
     }
 }
\ No newline at end of file
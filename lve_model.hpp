@@ -1,6 +1,8 @@
 #pragma once
 
 #include "lve_device.hpp"
+#include "lve_swap_chain.hpp"
+#include "lve_upload_queue.hpp"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -17,11 +19,36 @@ namespace lve
             {
                 glm::vec3 position;
                 glm::vec3 color;
+
+                bool operator==(const Vertex& other) const
+                {
+                    return position == other.position && color == other.color;
+                }
+
                 static std::vector<VkVertexInputBindingDescription> getBindingDescriptions();
                 static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
             };
 
-            LveModel(LveDevice& device, const std::vector<Vertex>& vertices);
+            // DeviceLocal uploads once through a staging buffer; HostVisible keeps one mapped vertex region per
+            // frame in flight so meshes rewritten every frame can use writeVertices() without a copy
+            enum class MemoryMode
+            {
+                DeviceLocal,
+                HostVisible
+            };
+
+            // unique vertices plus a triangle-list index buffer referencing them
+            struct Builder
+            {
+                std::vector<Vertex> vertices{};
+                std::vector<uint32_t> indices{};
+
+                // hashes every vertex of a flat triangle list so identical ones are stored only once
+                void loadTriangleList(const std::vector<Vertex>& triangle_list);
+            };
+
+            LveModel(LveDevice& device, const std::vector<Vertex>& vertices, MemoryMode memory_mode = MemoryMode::DeviceLocal);
+            LveModel(LveDevice& device, const Builder& builder, MemoryMode memory_mode = MemoryMode::DeviceLocal);
             ~LveModel();
 
             // deleting copy operator and copy constructor
@@ -29,14 +56,57 @@ namespace lve
             LveModel &operator=(const LveModel&) = delete;
 
             void bind(VkCommandBuffer command_buffer);
-            void draw(VkCommandBuffer command_buffer);
+            void draw(VkCommandBuffer command_buffer, uint32_t instance_count = 1, uint32_t first_instance = 0);   // vkCmdDrawIndexed when the model has an index buffer
+
+            // device local data is uploaded asynchronously, do not draw the model before this returns true
+            bool isUploaded();
+
+            // only valid for MemoryMode::HostVisible, vertex count must not change; writes the region of frame_index
+            // (LveRenderer::getFrameIndex()), which the GPU has stopped reading once beginFrame() returned, and bind()
+            // uses that region from now on. The other regions may still be read by frames in flight, so a model
+            // drawn in a frame has to be written in that frame before its draws are recorded
+            void writeVertices(int frame_index, const std::vector<Vertex>& vertices);
+
+            // draws with the parameters written by the GPU into buffer at offset, which holds a
+            // VkDrawIndexedIndirectCommand if hasIndexBuffer() and a VkDrawIndirectCommand otherwise
+            void drawIndirect(VkCommandBuffer command_buffer, VkBuffer buffer, VkDeviceSize offset);
+
+            bool hasIndexBuffer() const { return has_index_buffer_; }
+            uint32_t getIndexCount() const { return index_count_; }
+            uint32_t getVertexCount() const { return vertex_count_; }
+
+            // model space bounding volumes, computed from the vertices at creation and by writeVertices()
+            glm::vec4 getBoundingSphere() const { return bounding_sphere_; }   // xyz = center, w = radius
+            glm::vec3 getBoundingBoxMin() const { return bounding_box_min_; }
+            glm::vec3 getBoundingBoxMax() const { return bounding_box_max_; }
 
         private:
             void createVertexBuffers(const std::vector<Vertex>& vertices);
+            void createDeviceLocalVertexBuffer(const std::vector<Vertex>& vertices, VkDeviceSize buffer_size);
+            void createHostVisibleVertexBuffer(const std::vector<Vertex>& vertices, VkDeviceSize buffer_size);
+            void createIndexBuffers(const std::vector<uint32_t>& indices);
+            void createDeviceLocalBuffer(const void* data, VkDeviceSize buffer_size, VkBufferUsageFlags usage, VkBuffer& buffer, LveAllocation& buffer_allocation);
+            void computeBounds(const std::vector<Vertex>& vertices);
 
             LveDevice& lve_device_;
             VkBuffer vertex_buffer_;
-            VkDeviceMemory verterx_buffer_memory_;
+            LveAllocation vertex_buffer_allocation_;
             uint32_t vertex_count_;
+            MemoryMode memory_mode_;
+            void* mapped_vertices_ = nullptr;     // start of the first per-frame region
+            VkDeviceSize vertex_region_size_ = 0;
+            VkDeviceSize vertex_region_offset_ = 0;   // region bound by bind()
+            glm::vec4 bounding_sphere_{0.0f};
+            glm::vec3 bounding_box_min_{0.0f};
+            glm::vec3 bounding_box_max_{0.0f};
+
+            bool has_index_buffer_ = false;
+            VkBuffer index_buffer_;
+            LveAllocation index_buffer_allocation_;
+            uint32_t index_count_ = 0;
+            VkIndexType index_type_ = VK_INDEX_TYPE_UINT32;
+
+            LveUploadQueue::ticket_t upload_ticket_ = 0;
+            bool is_uploaded_ = false;
     };
 }
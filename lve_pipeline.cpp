@@ -7,9 +7,46 @@
 
 namespace lve
 {
+    namespace
+    {
+        VkSpecializationInfo makeSpecializationInfo(const PipelineSpecialization& specialization)
+        {
+            VkSpecializationInfo info{};
+            info.mapEntryCount = static_cast<uint32_t>(specialization.map_entries.size());
+            info.pMapEntries = specialization.map_entries.data();
+            info.dataSize = specialization.data.size();
+            info.pData = specialization.data.data();
+            return info;
+        }
+    }
+
     LvePipeline::LvePipeline(LveDevice& device, const std::string& vertex_shader_filepath, const std::string& frag_shader_filepath, const PipelineConfigInfo& config_info): lve_device_(device)
     {
-        createGraphicsPipeline(vertex_shader_filepath, frag_shader_filepath, config_info);
+        auto vertex_code = readFile(vertex_shader_filepath);
+        auto frag_code = readFile(frag_shader_filepath);
+
+        createShaderModule(vertex_code, &vertex_shader_module_);
+        createShaderModule(frag_code, &fragment_shader_module_);
+
+        createGraphicsPipeline(vertex_shader_module_, fragment_shader_module_, config_info, nullptr);
+    }
+
+    LvePipeline::LvePipeline(LveDevice& device, const std::string& compute_shader_filepath, VkPipelineLayout pipeline_layout): lve_device_(device), bind_point_(VK_PIPELINE_BIND_POINT_COMPUTE)
+    {
+        auto compute_code = readFile(compute_shader_filepath);
+        createShaderModule(compute_code, &vertex_shader_module_);
+
+        createComputePipeline(vertex_shader_module_, pipeline_layout, nullptr);
+    }
+
+    LvePipeline::LvePipeline(LveDevice& device, VkShaderModule vertex_shader_module, VkShaderModule frag_shader_module, const PipelineConfigInfo& config_info, const PipelineSpecialization* specialization): lve_device_(device)
+    {
+        createGraphicsPipeline(vertex_shader_module, frag_shader_module, config_info, specialization);
+    }
+
+    LvePipeline::LvePipeline(LveDevice& device, VkShaderModule compute_shader_module, VkPipelineLayout pipeline_layout, const PipelineSpecialization* specialization): lve_device_(device), bind_point_(VK_PIPELINE_BIND_POINT_COMPUTE)
+    {
+        createComputePipeline(compute_shader_module, pipeline_layout, specialization);
     }
 
     LvePipeline::~LvePipeline()
@@ -37,38 +74,38 @@ namespace lve
         return buffer;
     }
 
-    void LvePipeline::createGraphicsPipeline(const std::string& vertex_shader_filepath, const std::string& frag_shader_filepath, const PipelineConfigInfo& config_info)
+    void LvePipeline::createGraphicsPipeline(VkShaderModule vertex_shader_module, VkShaderModule frag_shader_module, const PipelineConfigInfo& config_info, const PipelineSpecialization* specialization)
     {
         assert(config_info.pipeline_layout != VK_NULL_HANDLE && "Cannot create graphics pipeline if pipeline_layout is not provided");
         assert(config_info.render_pass != VK_NULL_HANDLE && "Cannot create graphics pipeline if render_pass is not provided");
 
-        auto vertex_code = readFile(vertex_shader_filepath);
-        auto frag_code = readFile(frag_shader_filepath);
-
-        createShaderModule(vertex_code, &vertex_shader_module_);
-        createShaderModule(frag_code, &fragment_shader_module_);
+        VkSpecializationInfo specialization_info{};
+        if (specialization != nullptr)
+        {
+            specialization_info = makeSpecializationInfo(*specialization);
+        }
 
         VkPipelineShaderStageCreateInfo shader_stages[2];
         {
             shader_stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
             shader_stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
-            shader_stages[0].module = vertex_shader_module_;
+            shader_stages[0].module = vertex_shader_module;
             shader_stages[0].pName = "main";   // name of the entry function in vertex shader (see simple_shader.vert)
             shader_stages[0].flags = 0;
             shader_stages[0].pNext = nullptr;
-            shader_stages[0].pSpecializationInfo = nullptr;
+            shader_stages[0].pSpecializationInfo = specialization != nullptr ? &specialization_info : nullptr;
 
             shader_stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
             shader_stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-            shader_stages[1].module = fragment_shader_module_;
+            shader_stages[1].module = frag_shader_module;
             shader_stages[1].pName = "main";   // name of the entry function in vertex shader (see simple_shader.vert)
             shader_stages[1].flags = 0;
             shader_stages[1].pNext = nullptr;
-            shader_stages[1].pSpecializationInfo = nullptr;
+            shader_stages[1].pSpecializationInfo = specialization != nullptr ? &specialization_info : nullptr;
         }
 
-        auto binding_descriptions = LveModel::Vertex::getBindingDescriptions();
-        auto attribute_descriptions = LveModel::Vertex::getAttributeDescriptions();
+        const auto& binding_descriptions = config_info.binding_descriptions;
+        const auto& attribute_descriptions = config_info.attribute_descriptions;
         VkPipelineVertexInputStateCreateInfo vertex_input_info{};
         {
             vertex_input_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
@@ -100,12 +137,39 @@ namespace lve
             pipeline_info.basePipelineHandle = VK_NULL_HANDLE;
         }
 
-        if (vkCreateGraphicsPipelines(lve_device_.device(), VK_NULL_HANDLE, 1, &pipeline_info, nullptr, &graphics_pipeline_) != VK_SUCCESS)
+        if (vkCreateGraphicsPipelines(lve_device_.device(), lve_device_.pipelineCache(), 1, &pipeline_info, nullptr, &graphics_pipeline_) != VK_SUCCESS)
         {
             throw std::runtime_error("LvePipeline::createGraphicsPipeline(); failed to create graphics pipeline");
         }
     }
 
+    void LvePipeline::createComputePipeline(VkShaderModule compute_shader_module, VkPipelineLayout pipeline_layout, const PipelineSpecialization* specialization)
+    {
+        assert(pipeline_layout != VK_NULL_HANDLE && "Cannot create compute pipeline if pipeline_layout is not provided");
+
+        VkSpecializationInfo specialization_info{};
+        if (specialization != nullptr)
+        {
+            specialization_info = makeSpecializationInfo(*specialization);
+        }
+
+        VkComputePipelineCreateInfo pipeline_info{};
+        pipeline_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipeline_info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipeline_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipeline_info.stage.module = compute_shader_module;
+        pipeline_info.stage.pName = "main";
+        pipeline_info.stage.pSpecializationInfo = specialization != nullptr ? &specialization_info : nullptr;
+        pipeline_info.layout = pipeline_layout;
+        pipeline_info.basePipelineIndex = -1;
+        pipeline_info.basePipelineHandle = VK_NULL_HANDLE;
+
+        if (vkCreateComputePipelines(lve_device_.device(), lve_device_.pipelineCache(), 1, &pipeline_info, nullptr, &graphics_pipeline_) != VK_SUCCESS)
+        {
+            throw std::runtime_error("LvePipeline::createComputePipeline(); failed to create compute pipeline");
+        }
+    }
+
     void LvePipeline::createShaderModule(const std::vector<char>& code, VkShaderModule* shader_module)
     {
         VkShaderModuleCreateInfo info{};
@@ -121,7 +185,7 @@ namespace lve
 
     void LvePipeline::bind(VkCommandBuffer command_buffer)
     {
-        vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphics_pipeline_);
+        vkCmdBindPipeline(command_buffer, bind_point_, graphics_pipeline_);
     }
 
     void LvePipeline::default_pipeline_config_info_(PipelineConfigInfo& config_info)
@@ -221,5 +285,25 @@ namespace lve
             config_info.dynamic_state_info.dynamicStateCount = static_cast<uint32_t>(config_info.dynamic_state_enables.size());
             config_info.dynamic_state_info.flags = 0;
         }
+
+        // vertex input, render systems append per-instance bindings and attributes
+        {
+            config_info.binding_descriptions = LveModel::Vertex::getBindingDescriptions();
+            config_info.attribute_descriptions = LveModel::Vertex::getAttributeDescriptions();
+        }
+    }
+
+    void LvePipeline::copyConfigInfo(const PipelineConfigInfo& source, PipelineConfigInfo& target)
+    {
+        target = source;
+        // pointers into source's own members would still point there after the member-wise copy
+        if (source.color_blend_info.pAttachments == &source.color_blend_attachment)
+        {
+            target.color_blend_info.pAttachments = &target.color_blend_attachment;
+        }
+        if (source.dynamic_state_info.pDynamicStates == source.dynamic_state_enables.data())
+        {
+            target.dynamic_state_info.pDynamicStates = target.dynamic_state_enables.data();
+        }
     }
 }
\ No newline at end of file
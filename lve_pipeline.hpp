@@ -2,7 +2,10 @@
 
 #include "lve_device.hpp"
 
+#include <cstdint>
+#include <cstring>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 namespace lve
@@ -18,14 +21,38 @@ namespace lve
         VkPipelineDepthStencilStateCreateInfo depth_stencil_info;
         std::vector<VkDynamicState> dynamic_state_enables;
         VkPipelineDynamicStateCreateInfo dynamic_state_info;
+        std::vector<VkVertexInputBindingDescription> binding_descriptions{};       // defaults to LveModel::Vertex
+        std::vector<VkVertexInputAttributeDescription> attribute_descriptions{};
         VkPipelineLayout pipeline_layout = nullptr;
         VkRenderPass render_pass = nullptr;
         uint32_t subpass = 0;
     };
+
+    // specialization constants, the same values are given to every shader stage of a pipeline
+    struct PipelineSpecialization
+    {
+        std::vector<VkSpecializationMapEntry> map_entries;
+        std::vector<uint8_t> data;
+
+        template<typename T>
+        void set(uint32_t constant_id, const T& value)
+        {
+            static_assert(std::is_trivially_copyable<T>::value, "specialization constants are copied bytewise");
+            map_entries.push_back({constant_id, static_cast<uint32_t>(data.size()), sizeof(T)});
+            data.resize(data.size() + sizeof(T));
+            std::memcpy(data.data() + data.size() - sizeof(T), &value, sizeof(T));
+        }
+    };
+
     class LvePipeline
     {
         public:
             LvePipeline(LveDevice& device, const std::string& vertex_shader_filepath, const std::string& frag_shader_filepath, const PipelineConfigInfo& config_info);
+            // compute pipeline
+            LvePipeline(LveDevice& device, const std::string& compute_shader_filepath, VkPipelineLayout pipeline_layout);
+            // from shader modules owned by the caller, they are only needed while the constructor runs
+            LvePipeline(LveDevice& device, VkShaderModule vertex_shader_module, VkShaderModule frag_shader_module, const PipelineConfigInfo& config_info, const PipelineSpecialization* specialization = nullptr);
+            LvePipeline(LveDevice& device, VkShaderModule compute_shader_module, VkPipelineLayout pipeline_layout, const PipelineSpecialization* specialization = nullptr);
             ~LvePipeline();
 
             // deleting copy operator and copy constructor (https://youtu.be/LYKlEIzGmW4?t=549)
@@ -35,17 +62,22 @@ namespace lve
             void bind(VkCommandBuffer command_buffer);
 
             static void default_pipeline_config_info_(PipelineConfigInfo& config_info);
+            // PipelineConfigInfo points into itself, a plain copy would keep pointing into source
+            static void copyConfigInfo(const PipelineConfigInfo& source, PipelineConfigInfo& target);
 
-        private:
             static std::vector<char> readFile(const std::string& filepath);
 
-            void createGraphicsPipeline(const std::string& vertex_shader_filepath, const std::string& frag_shader_filepath, const PipelineConfigInfo& config_info);
+        private:
+            void createGraphicsPipeline(VkShaderModule vertex_shader_module, VkShaderModule frag_shader_module, const PipelineConfigInfo& config_info, const PipelineSpecialization* specialization);
+
+            void createComputePipeline(VkShaderModule compute_shader_module, VkPipelineLayout pipeline_layout, const PipelineSpecialization* specialization);
 
             void createShaderModule(const std::vector<char>& code, VkShaderModule* shader_module);
 
             LveDevice& lve_device_;
-            VkPipeline graphics_pipeline_;
-            VkShaderModule vertex_shader_module_;
-            VkShaderModule fragment_shader_module_;
+            VkPipelineBindPoint bind_point_ = VK_PIPELINE_BIND_POINT_GRAPHICS;
+            VkPipeline graphics_pipeline_;   // also holds the compute pipeline, see bind_point_
+            VkShaderModule vertex_shader_module_ = VK_NULL_HANDLE;     // compute shader for compute pipelines, VK_NULL_HANDLE if the caller owns the modules
+            VkShaderModule fragment_shader_module_ = VK_NULL_HANDLE;
     };
 }
\ No newline at end of file
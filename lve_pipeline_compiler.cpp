@@ -0,0 +1,120 @@
+#include "lve_pipeline_compiler.hpp"
+#include "lve_cpu_profiler.hpp"
+#include "lve_pipeline_registry.hpp"
+
+#include <cassert>
+#include <exception>
+#include <utility>
+
+namespace lve
+{
+    const std::string& LveAsyncPipeline::getError() const
+    {
+        static const std::string no_error{};
+        return isFailed() ? error_ : no_error;
+    }
+
+    void LveAsyncPipeline::wait() const
+    {
+        std::unique_lock<std::mutex> lock{mutex_};
+        finished_.wait(lock, [this]() { return getState() != State::Compiling; });
+    }
+
+    void LveAsyncPipeline::finish(std::shared_ptr<LvePipeline> pipeline, std::string error)
+    {
+        {
+            std::lock_guard<std::mutex> lock{mutex_};
+            pipeline_ = std::move(pipeline);
+            error_ = std::move(error);
+            // release: pipeline_ and error_ are visible to whoever sees the new state
+            state_.store(pipeline_ != nullptr ? State::Ready : State::Failed, std::memory_order_release);
+        }
+        finished_.notify_all();
+    }
+
+    LvePipelineCompiler::LvePipelineCompiler(LveDevice& device, uint32_t thread_count) : lve_device_(device)
+    {
+        assert(thread_count > 0 && "at least one compile thread is needed");
+        threads_.reserve(thread_count);
+        for (uint32_t i = 0; i < thread_count; i++)
+        {
+            threads_.emplace_back(&LvePipelineCompiler::workerLoop, this);
+        }
+    }
+
+    LvePipelineCompiler::~LvePipelineCompiler()
+    {
+        {
+            std::lock_guard<std::mutex> lock{mutex_};
+            stopping_ = true;
+        }
+        requests_available_.notify_all();
+        for (auto& thread : threads_)
+        {
+            thread.join();
+        }
+    }
+
+    std::shared_ptr<LveAsyncPipeline> LvePipelineCompiler::compileGraphics(const std::string& vertex_shader_filepath, const std::string& frag_shader_filepath, const PipelineConfigInfo& config_info)
+    {
+        auto request = std::make_unique<Request>();
+        request->pipeline = std::make_shared<LveAsyncPipeline>();
+        request->vertex_shader_filepath = vertex_shader_filepath;
+        request->frag_shader_filepath = frag_shader_filepath;
+        LvePipeline::copyConfigInfo(config_info, request->config_info);
+
+        auto pipeline = request->pipeline;
+        pending_count_.fetch_add(1, std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lock{mutex_};
+            requests_.push_back(std::move(request));
+        }
+        requests_available_.notify_one();
+        return pipeline;
+    }
+
+    std::shared_ptr<LveAsyncPipeline> LvePipelineCompiler::compileGraphicsNow(LveDevice& device, const std::string& vertex_shader_filepath, const std::string& frag_shader_filepath, const PipelineConfigInfo& config_info)
+    {
+        Request request{std::make_shared<LveAsyncPipeline>(), vertex_shader_filepath, frag_shader_filepath, {}};
+        LvePipeline::copyConfigInfo(config_info, request.config_info);
+        compile(device, request);
+        return request.pipeline;
+    }
+
+    void LvePipelineCompiler::compile(LveDevice& device, Request& request)
+    {
+        LVE_CPU_ZONE("LvePipelineCompiler::compile");
+        std::shared_ptr<LvePipeline> pipeline;
+        std::string error;
+        try
+        {
+            pipeline = device.pipelineRegistry().getGraphicsPipeline(request.vertex_shader_filepath, request.frag_shader_filepath, request.config_info);
+        }
+        catch (const std::exception& exception)
+        {
+            error = exception.what();
+        }
+        request.pipeline->finish(std::move(pipeline), std::move(error));
+    }
+
+    void LvePipelineCompiler::workerLoop()
+    {
+        while (true)
+        {
+            std::unique_ptr<Request> request;
+            {
+                std::unique_lock<std::mutex> lock{mutex_};
+                requests_available_.wait(lock, [this]() { return stopping_ || !requests_.empty(); });
+                if (requests_.empty())
+                {
+                    return;   // stopping and nothing left to compile
+                }
+                request = std::move(requests_.front());
+                requests_.pop_front();
+            }
+
+            compile(lve_device_, *request);
+            pending_count_.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "lve_device.hpp"
+#include "lve_pipeline.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace lve
+{
+    /**
+        Handle to a pipeline that may still be compiling. getState() is a single atomic load, so render
+        systems can poll it every frame and skip their draws (or use a fallback pipeline) until the
+        pipeline is Ready. A pipeline that failed to compile stays Failed and keeps the error message.
+    */
+    class LveAsyncPipeline
+    {
+        public:
+            enum class State
+            {
+                Compiling,
+                Ready,
+                Failed
+            };
+
+            LveAsyncPipeline() = default;
+
+            // deleting copy operator and copy constructor
+            LveAsyncPipeline(const LveAsyncPipeline&) = delete;
+            LveAsyncPipeline &operator=(const LveAsyncPipeline&) = delete;
+
+            State getState() const { return state_.load(std::memory_order_acquire); }
+            bool isReady() const { return getState() == State::Ready; }
+            bool isFailed() const { return getState() == State::Failed; }
+
+            // nullptr until the pipeline is Ready
+            LvePipeline* get() const { return isReady() ? pipeline_.get() : nullptr; }
+            // what vkCreateGraphicsPipelines or the shader loading threw, empty unless Failed
+            const std::string& getError() const;
+
+            // blocks until the pipeline is Ready or Failed
+            void wait() const;
+
+        private:
+            friend class LvePipelineCompiler;
+
+            void finish(std::shared_ptr<LvePipeline> pipeline, std::string error);
+
+            std::shared_ptr<LvePipeline> pipeline_;   // may be shared with other handles through the LvePipelineRegistry
+            std::string error_;
+            std::atomic<State> state_{State::Compiling};
+            mutable std::mutex mutex_;
+            mutable std::condition_variable finished_;
+    };
+
+    /**
+        Compiles graphics pipelines on dedicated background threads, so creating one does not stall the
+        thread that asked for it. Pipeline creation takes milliseconds and cannot be split, so it does not
+        run on the LveJobSystem, where it would hold up the short per-frame jobs (and a frame waiting in
+        parallelFor() could end up executing it). Pipelines come from the device's LvePipelineRegistry, so a
+        permutation that already exists is handed out again instead of being compiled twice, and all compiles
+        share the device's VkPipelineCache, which Vulkan synchronizes internally.
+    */
+    class LvePipelineCompiler
+    {
+        public:
+            explicit LvePipelineCompiler(LveDevice& device, uint32_t thread_count = 1);
+            // finishes every queued compile before joining the threads
+            ~LvePipelineCompiler();
+
+            // deleting copy operator and copy constructor
+            LvePipelineCompiler(const LvePipelineCompiler&) = delete;
+            LvePipelineCompiler &operator=(const LvePipelineCompiler&) = delete;
+
+            // queues the pipeline and returns at once; config_info is copied, its layout and render pass
+            // have to stay alive until the handle is no longer Compiling
+            std::shared_ptr<LveAsyncPipeline> compileGraphics(const std::string& vertex_shader_filepath, const std::string& frag_shader_filepath, const PipelineConfigInfo& config_info);
+
+            // compiles on the calling thread, the returned handle is already Ready or Failed
+            static std::shared_ptr<LveAsyncPipeline> compileGraphicsNow(LveDevice& device, const std::string& vertex_shader_filepath, const std::string& frag_shader_filepath, const PipelineConfigInfo& config_info);
+
+            // compiles queued or running right now
+            uint32_t getPendingCount() const { return pending_count_.load(std::memory_order_relaxed); }
+
+        private:
+            struct Request
+            {
+                std::shared_ptr<LveAsyncPipeline> pipeline;
+                std::string vertex_shader_filepath;
+                std::string frag_shader_filepath;
+                PipelineConfigInfo config_info;
+            };
+
+            static void compile(LveDevice& device, Request& request);
+            void workerLoop();
+
+            LveDevice& lve_device_;
+            std::vector<std::thread> threads_;
+            std::deque<std::unique_ptr<Request>> requests_;   // unique_ptr, config_info must not move once its pointers are fixed up
+            std::mutex mutex_;
+            std::condition_variable requests_available_;
+            std::atomic<uint32_t> pending_count_{0};
+            bool stopping_ = false;
+    };
+}
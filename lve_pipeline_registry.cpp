@@ -0,0 +1,275 @@
+#include "lve_pipeline_registry.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+#include <type_traits>
+
+namespace lve
+{
+    namespace
+    {
+        // appends the bytes of plain values, the key compares equal exactly when all of them are equal
+        class KeyWriter
+        {
+            public:
+                template<typename T>
+                void write(const T& value)
+                {
+                    static_assert(std::is_trivially_copyable<T>::value, "only plain values can be part of a key");
+                    key_.append(reinterpret_cast<const char*>(&value), sizeof(T));
+                }
+
+                // count first, so two arrays next to each other cannot be confused with differently split ones;
+                // only for structs without pointers or padding
+                template<typename T>
+                void writeArray(const T* values, size_t count)
+                {
+                    write(static_cast<uint64_t>(count));
+                    if (count > 0)
+                    {
+                        key_.append(reinterpret_cast<const char*>(values), count * sizeof(T));
+                    }
+                }
+
+                std::string& key() { return key_; }
+
+            private:
+                std::string key_;
+        };
+
+        // field by field, the create info structs carry sType/pNext and pointers that must not end up in the key
+        void writeConfigInfo(KeyWriter& writer, const PipelineConfigInfo& config_info)
+        {
+            const auto& input_assembly = config_info.input_assembly_info;
+            writer.write(input_assembly.topology);
+            writer.write(input_assembly.primitiveRestartEnable);
+
+            // viewports and scissors are dynamic, only their counts are baked in
+            writer.write(config_info.viewport_info.viewportCount);
+            writer.write(config_info.viewport_info.scissorCount);
+
+            const auto& rasterization = config_info.rasterization_info;
+            writer.write(rasterization.depthClampEnable);
+            writer.write(rasterization.rasterizerDiscardEnable);
+            writer.write(rasterization.polygonMode);
+            writer.write(rasterization.lineWidth);
+            writer.write(rasterization.cullMode);
+            writer.write(rasterization.frontFace);
+            writer.write(rasterization.depthBiasEnable);
+            writer.write(rasterization.depthBiasConstantFactor);
+            writer.write(rasterization.depthBiasClamp);
+            writer.write(rasterization.depthBiasSlopeFactor);
+
+            const auto& multisample = config_info.multisample_info;
+            writer.write(multisample.rasterizationSamples);
+            writer.write(multisample.sampleShadingEnable);
+            writer.write(multisample.minSampleShading);
+            writer.write(multisample.alphaToCoverageEnable);
+            writer.write(multisample.alphaToOneEnable);
+            const uint32_t sample_mask_words = multisample.pSampleMask != nullptr ? (multisample.rasterizationSamples + 31) / 32 : 0;
+            writer.writeArray(multisample.pSampleMask, sample_mask_words);
+
+            const auto& color_blend = config_info.color_blend_info;
+            writer.write(color_blend.logicOpEnable);
+            writer.write(color_blend.logicOp);
+            writer.writeArray(color_blend.pAttachments, color_blend.attachmentCount);
+            for (float constant : color_blend.blendConstants)
+            {
+                writer.write(constant);
+            }
+
+            const auto& depth_stencil = config_info.depth_stencil_info;
+            writer.write(depth_stencil.depthTestEnable);
+            writer.write(depth_stencil.depthWriteEnable);
+            writer.write(depth_stencil.depthCompareOp);
+            writer.write(depth_stencil.depthBoundsTestEnable);
+            writer.write(depth_stencil.minDepthBounds);
+            writer.write(depth_stencil.maxDepthBounds);
+            writer.write(depth_stencil.stencilTestEnable);
+            writer.write(depth_stencil.front);
+            writer.write(depth_stencil.back);
+
+            writer.writeArray(config_info.dynamic_state_info.pDynamicStates, config_info.dynamic_state_info.dynamicStateCount);
+            writer.writeArray(config_info.binding_descriptions.data(), config_info.binding_descriptions.size());
+            writer.writeArray(config_info.attribute_descriptions.data(), config_info.attribute_descriptions.size());
+
+            writer.write(config_info.pipeline_layout);
+            writer.write(config_info.render_pass);
+            writer.write(config_info.subpass);
+        }
+
+        void writeSpecialization(KeyWriter& writer, const PipelineSpecialization* specialization)
+        {
+            if (specialization == nullptr)
+            {
+                writer.write(uint64_t{0});
+                return;
+            }
+            writer.writeArray(specialization->map_entries.data(), specialization->map_entries.size());
+            writer.writeArray(specialization->data.data(), specialization->data.size());
+        }
+
+        // owner of a pipeline handed out by the registry, the handles alias the pipeline inside it;
+        // members are destroyed when the last handle goes, unlike a deleter that lives as long as any weak_ptr
+        struct PipelineWithModules
+        {
+            std::vector<std::shared_ptr<LveShaderModule>> shader_modules;
+            std::unique_ptr<LvePipeline> pipeline;   // destroyed before the modules
+        };
+
+        template<typename T>
+        void removeExpired(std::unordered_map<std::string, std::weak_ptr<T>>& cache)
+        {
+            for (auto it = cache.begin(); it != cache.end();)
+            {
+                it = it->second.expired() ? cache.erase(it) : std::next(it);
+            }
+        }
+
+        template<typename T>
+        uint32_t countAlive(const std::unordered_map<std::string, std::weak_ptr<T>>& cache)
+        {
+            return static_cast<uint32_t>(std::count_if(cache.begin(), cache.end(), [](const auto& entry) { return !entry.second.expired(); }));
+        }
+    }
+
+    LveShaderModule::LveShaderModule(LveDevice& device, const std::vector<char>& code) : lve_device_(device)
+    {
+        VkShaderModuleCreateInfo info{};
+        info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        info.codeSize = code.size();
+        info.pCode = reinterpret_cast<const uint32_t*>(code.data());
+
+        if (vkCreateShaderModule(lve_device_.device(), &info, nullptr, &shader_module_) != VK_SUCCESS)
+        {
+            throw std::runtime_error("LveShaderModule::LveShaderModule(); failed to create shader module");
+        }
+    }
+
+    LveShaderModule::~LveShaderModule()
+    {
+        vkDestroyShaderModule(lve_device_.device(), shader_module_, nullptr);
+    }
+
+    LvePipelineLayout::LvePipelineLayout(LveDevice& device, const std::vector<VkDescriptorSetLayout>& set_layouts, const std::vector<VkPushConstantRange>& push_constant_ranges) : lve_device_(device)
+    {
+        VkPipelineLayoutCreateInfo info{};
+        info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        info.setLayoutCount = static_cast<uint32_t>(set_layouts.size());
+        info.pSetLayouts = set_layouts.data();
+        info.pushConstantRangeCount = static_cast<uint32_t>(push_constant_ranges.size());
+        info.pPushConstantRanges = push_constant_ranges.data();
+
+        if (vkCreatePipelineLayout(lve_device_.device(), &info, nullptr, &pipeline_layout_) != VK_SUCCESS)
+        {
+            throw std::runtime_error("LvePipelineLayout::LvePipelineLayout(); could not create pipeline layout");
+        }
+    }
+
+    LvePipelineLayout::~LvePipelineLayout()
+    {
+        vkDestroyPipelineLayout(lve_device_.device(), pipeline_layout_, nullptr);
+    }
+
+    LvePipelineRegistry::LvePipelineRegistry(LveDevice& device) : lve_device_(device)
+    {
+    }
+
+    std::shared_ptr<LveShaderModule> LvePipelineRegistry::getShaderModule(const std::string& filepath)
+    {
+        auto code = LvePipeline::readFile(filepath);
+        const std::string key(code.begin(), code.end());
+        return findOrCreate(shader_modules_, key, [this, &code]()
+        {
+            return std::make_shared<LveShaderModule>(lve_device_, code);
+        });
+    }
+
+    std::shared_ptr<LvePipelineLayout> LvePipelineRegistry::getPipelineLayout(const std::vector<VkDescriptorSetLayout>& set_layouts, const std::vector<VkPushConstantRange>& push_constant_ranges)
+    {
+        KeyWriter writer;
+        writer.writeArray(set_layouts.data(), set_layouts.size());
+        writer.writeArray(push_constant_ranges.data(), push_constant_ranges.size());
+        return findOrCreate(pipeline_layouts_, writer.key(), [&]()
+        {
+            return std::make_shared<LvePipelineLayout>(lve_device_, set_layouts, push_constant_ranges);
+        });
+    }
+
+    std::shared_ptr<LvePipeline> LvePipelineRegistry::getGraphicsPipeline(const std::string& vertex_shader_filepath, const std::string& frag_shader_filepath, const PipelineConfigInfo& config_info, const PipelineSpecialization* specialization)
+    {
+        auto vertex_shader_module = getShaderModule(vertex_shader_filepath);
+        auto frag_shader_module = getShaderModule(frag_shader_filepath);
+
+        KeyWriter writer;
+        writer.write(VK_PIPELINE_BIND_POINT_GRAPHICS);
+        writer.write(vertex_shader_module->get());
+        writer.write(frag_shader_module->get());
+        writeSpecialization(writer, specialization);
+        writeConfigInfo(writer, config_info);
+        return findOrCreate(pipelines_, writer.key(), [&]()
+        {
+            // the modules stay alive with the pipeline, so pipelines created later from the same shaders find them
+            auto owner = std::make_shared<PipelineWithModules>();
+            owner->shader_modules = {vertex_shader_module, frag_shader_module};
+            owner->pipeline = std::make_unique<LvePipeline>(lve_device_, vertex_shader_module->get(), frag_shader_module->get(), config_info, specialization);
+            return std::shared_ptr<LvePipeline>(owner, owner->pipeline.get());
+        });
+    }
+
+    std::shared_ptr<LvePipeline> LvePipelineRegistry::getComputePipeline(const std::string& compute_shader_filepath, VkPipelineLayout pipeline_layout, const PipelineSpecialization* specialization)
+    {
+        auto compute_shader_module = getShaderModule(compute_shader_filepath);
+
+        KeyWriter writer;
+        writer.write(VK_PIPELINE_BIND_POINT_COMPUTE);
+        writer.write(compute_shader_module->get());
+        writeSpecialization(writer, specialization);
+        writer.write(pipeline_layout);
+        return findOrCreate(pipelines_, writer.key(), [&]()
+        {
+            auto owner = std::make_shared<PipelineWithModules>();
+            owner->shader_modules = {compute_shader_module};
+            owner->pipeline = std::make_unique<LvePipeline>(lve_device_, compute_shader_module->get(), pipeline_layout, specialization);
+            return std::shared_ptr<LvePipeline>(owner, owner->pipeline.get());
+        });
+    }
+
+    LvePipelineRegistry::Stats LvePipelineRegistry::getStats()
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        return {countAlive(shader_modules_), countAlive(pipeline_layouts_), countAlive(pipelines_), request_count_, creation_count_};
+    }
+
+    template<typename T, typename Create>
+    std::shared_ptr<T> LvePipelineRegistry::findOrCreate(std::unordered_map<std::string, std::weak_ptr<T>>& cache, const std::string& key, const Create& create)
+    {
+        {
+            std::lock_guard<std::mutex> lock{mutex_};
+            request_count_++;
+            auto it = cache.find(key);
+            if (it != cache.end())
+            {
+                if (auto existing = it->second.lock())
+                {
+                    return existing;
+                }
+            }
+        }
+
+        // creating a pipeline takes milliseconds, other threads keep looking up in the meantime
+        std::shared_ptr<T> created = create();
+
+        std::lock_guard<std::mutex> lock{mutex_};
+        auto& entry = cache[key];
+        if (auto existing = entry.lock())
+        {
+            return existing;   // another thread created the same object first, ours is dropped
+        }
+        entry = created;
+        creation_count_++;
+        removeExpired(cache);
+        return created;
+    }
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "lve_device.hpp"
+#include "lve_pipeline.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace lve
+{
+    // shader module shared by every pipeline built from the same SPIR-V
+    class LveShaderModule
+    {
+        public:
+            LveShaderModule(LveDevice& device, const std::vector<char>& code);
+            ~LveShaderModule();
+
+            // deleting copy operator and copy constructor
+            LveShaderModule(const LveShaderModule&) = delete;
+            LveShaderModule &operator=(const LveShaderModule&) = delete;
+
+            VkShaderModule get() const { return shader_module_; }
+
+        private:
+            LveDevice& lve_device_;
+            VkShaderModule shader_module_ = VK_NULL_HANDLE;
+    };
+
+    class LvePipelineLayout
+    {
+        public:
+            LvePipelineLayout(LveDevice& device, const std::vector<VkDescriptorSetLayout>& set_layouts, const std::vector<VkPushConstantRange>& push_constant_ranges);
+            ~LvePipelineLayout();
+
+            // deleting copy operator and copy constructor
+            LvePipelineLayout(const LvePipelineLayout&) = delete;
+            LvePipelineLayout &operator=(const LvePipelineLayout&) = delete;
+
+            VkPipelineLayout get() const { return pipeline_layout_; }
+
+        private:
+            LveDevice& lve_device_;
+            VkPipelineLayout pipeline_layout_ = VK_NULL_HANDLE;
+    };
+
+    /**
+        Central cache of shader modules, pipeline layouts and pipelines, owned by LveDevice.
+        Every request is turned into a key holding everything that goes into the Vulkan object: the SPIR-V
+        of a shader module; the set layouts and push constant ranges of a pipeline layout; the fixed function
+        state of the PipelineConfigInfo, its vertex layout, pipeline layout, render pass, shader modules and
+        specialization constants for a pipeline (pNext chains are not part of the key). Equal keys get the
+        same shared handle, so render systems asking for the same permutation share one object, and a
+        pipeline keeps its shader modules alive so other pipelines using the same shader reuse them.
+        The registry only holds weak references, an object is destroyed with its last handle; callers have
+        to keep handles until the GPU no longer uses them, as with any pipeline. Lookups are thread safe and
+        objects are created outside the lock, so LvePipelineCompiler threads can use it while frames record.
+    */
+    class LvePipelineRegistry
+    {
+        public:
+            struct Stats
+            {
+                uint32_t shader_modules;     // alive right now
+                uint32_t pipeline_layouts;
+                uint32_t pipelines;
+                uint32_t request_count;      // get*() calls so far
+                uint32_t creation_count;     // of those, how many had to create a new object
+            };
+
+            explicit LvePipelineRegistry(LveDevice& device);
+
+            // deleting copy operator and copy constructor
+            LvePipelineRegistry(const LvePipelineRegistry&) = delete;
+            LvePipelineRegistry &operator=(const LvePipelineRegistry&) = delete;
+
+            // keyed by file content, so a changed file gets a new module
+            std::shared_ptr<LveShaderModule> getShaderModule(const std::string& filepath);
+            std::shared_ptr<LvePipelineLayout> getPipelineLayout(const std::vector<VkDescriptorSetLayout>& set_layouts, const std::vector<VkPushConstantRange>& push_constant_ranges);
+
+            std::shared_ptr<LvePipeline> getGraphicsPipeline(const std::string& vertex_shader_filepath, const std::string& frag_shader_filepath, const PipelineConfigInfo& config_info, const PipelineSpecialization* specialization = nullptr);
+            std::shared_ptr<LvePipeline> getComputePipeline(const std::string& compute_shader_filepath, VkPipelineLayout pipeline_layout, const PipelineSpecialization* specialization = nullptr);
+
+            Stats getStats();
+
+        private:
+            // returns the live object stored under key, or stores and returns create()
+            template<typename T, typename Create>
+            std::shared_ptr<T> findOrCreate(std::unordered_map<std::string, std::weak_ptr<T>>& cache, const std::string& key, const Create& create);
+
+            LveDevice& lve_device_;
+            std::mutex mutex_;   // guards the maps and counters, never held while creating an object
+            std::unordered_map<std::string, std::weak_ptr<LveShaderModule>> shader_modules_;
+            std::unordered_map<std::string, std::weak_ptr<LvePipelineLayout>> pipeline_layouts_;
+            std::unordered_map<std::string, std::weak_ptr<LvePipeline>> pipelines_;
+            uint32_t request_count_ = 0;
+            uint32_t creation_count_ = 0;
+    };
+}
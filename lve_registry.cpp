@@ -0,0 +1,32 @@
+#include "lve_registry.hpp"
+
+namespace lve
+{
+    LveEntity LveRegistry::create()
+    {
+        if (!free_indices_.empty())
+        {
+            const uint32_t index = free_indices_.back();
+            free_indices_.pop_back();
+            return {index, generations_[index]};
+        }
+
+        generations_.push_back(0);
+        return {static_cast<uint32_t>(generations_.size() - 1), 0};
+    }
+
+    void LveRegistry::destroy(LveEntity entity)
+    {
+        assert(valid(entity) && "entity has already been destroyed");
+        for (auto& pool : pools_)
+        {
+            if (pool != nullptr && pool->contains(entity.index))
+            {
+                pool->remove(entity.index);
+            }
+        }
+
+        generations_[entity.index]++;
+        free_indices_.push_back(entity.index);
+    }
+}
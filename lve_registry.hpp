@@ -0,0 +1,238 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace lve
+{
+    // slot index plus the generation the slot had when the entity was created, handles of destroyed
+    // entities are detected because destroying moves the slot's generation on
+    struct LveEntity
+    {
+        uint32_t index = UINT32_MAX;
+        uint32_t generation = 0;
+
+        bool operator==(const LveEntity& other) const { return index == other.index && generation == other.generation; }
+        bool operator!=(const LveEntity& other) const { return !(*this == other); }
+    };
+
+    constexpr LveEntity NULL_ENTITY{};
+
+    /**
+        Sparse set of one component type: sparse maps entity index -> dense slot, the dense arrays hold
+        entities and components without holes. Iteration is a linear walk, removal moves the last
+        component into the hole, both lookups and removal are O(1).
+    */
+    class LveComponentPoolBase
+    {
+        public:
+            virtual ~LveComponentPoolBase() = default;
+
+            virtual void remove(uint32_t entity_index) = 0;
+
+            bool contains(uint32_t entity_index) const { return entity_index < sparse_.size() && sparse_[entity_index] != NO_SLOT; }
+            size_t size() const { return dense_entities_.size(); }
+            const std::vector<LveEntity>& getEntities() const { return dense_entities_; }
+
+        protected:
+            static constexpr uint32_t NO_SLOT = UINT32_MAX;
+
+            std::vector<uint32_t> sparse_;
+            std::vector<LveEntity> dense_entities_;
+    };
+
+    template<typename Component>
+    class LveComponentPool : public LveComponentPoolBase
+    {
+        public:
+            template<typename... Args>
+            Component& emplace(LveEntity entity, Args&&... args)
+            {
+                assert(!contains(entity.index) && "entity already has this component");
+                if (entity.index >= sparse_.size())
+                {
+                    sparse_.resize(entity.index + 1, NO_SLOT);
+                }
+                sparse_[entity.index] = static_cast<uint32_t>(dense_entities_.size());
+                dense_entities_.push_back(entity);
+
+                // aggregates (most components) are brace initialized
+                if constexpr (std::is_constructible_v<Component, Args...>)
+                {
+                    components_.emplace_back(std::forward<Args>(args)...);
+                }
+                else
+                {
+                    components_.push_back(Component{std::forward<Args>(args)...});
+                }
+                return components_.back();
+            }
+
+            void remove(uint32_t entity_index) override
+            {
+                assert(contains(entity_index) && "entity does not have this component");
+                const uint32_t slot = sparse_[entity_index];
+                const uint32_t last = static_cast<uint32_t>(dense_entities_.size() - 1);
+                if (slot != last)
+                {
+                    components_[slot] = std::move(components_[last]);
+                    dense_entities_[slot] = dense_entities_[last];
+                    sparse_[dense_entities_[slot].index] = slot;
+                }
+                components_.pop_back();
+                dense_entities_.pop_back();
+                sparse_[entity_index] = NO_SLOT;
+            }
+
+            Component& get(uint32_t entity_index)
+            {
+                assert(contains(entity_index) && "entity does not have this component");
+                return components_[sparse_[entity_index]];
+            }
+
+            // dense components, in the same order as getEntities()
+            std::vector<Component>& getComponents() { return components_; }
+
+        private:
+            std::vector<Component> components_;
+    };
+
+    // entities having every one of the Components, see LveRegistry::view()
+    template<typename... Components>
+    class LveView
+    {
+        public:
+            explicit LveView(LveComponentPool<Components>&... pools) : pools_{&pools...} {}
+
+            /**
+                Calls function(entity, Components&...) for every matching entity. The smallest pool drives
+                the walk and the others are probed through their sparse arrays, so a view over a rare
+                component stays cheap. Components may be modified, but not added or removed, during the walk.
+            */
+            template<typename Function>
+            void each(Function function)
+            {
+                const LveComponentPoolBase* driver = std::get<0>(pools_);
+                std::apply([&driver](auto*... pools) { ((driver = pools->size() < driver->size() ? pools : driver), ...); }, pools_);
+
+                for (const LveEntity entity : driver->getEntities())
+                {
+                    const bool complete = std::apply([&entity](auto*... pools) { return (pools->contains(entity.index) && ...); }, pools_);
+                    if (complete)
+                    {
+                        function(entity, std::get<LveComponentPool<Components>*>(pools_)->get(entity.index)...);
+                    }
+                }
+            }
+
+            // upper bound of the number of entities each() visits
+            size_t sizeHint() const
+            {
+                size_t size = SIZE_MAX;
+                std::apply([&size](auto*... pools) { ((size = std::min(size, pools->size())), ...); }, pools_);
+                return size;
+            }
+
+        private:
+            std::tuple<LveComponentPool<Components>*...> pools_;
+    };
+
+    /**
+        Entity/component registry: entities are generational handles, components of each type live in
+        their own packed LveComponentPool. create() and destroy() are O(1) (destroy visits every
+        component type once), slots of destroyed entities are reused.
+    */
+    class LveRegistry
+    {
+        public:
+            LveRegistry() = default;
+
+            // deleting copy operator and copy constructor
+            LveRegistry(const LveRegistry&) = delete;
+            LveRegistry &operator=(const LveRegistry&) = delete;
+
+            LveEntity create();
+            // removes all components of the entity, its handle becomes invalid
+            void destroy(LveEntity entity);
+            bool valid(LveEntity entity) const { return entity.index < generations_.size() && generations_[entity.index] == entity.generation; }
+            size_t size() const { return generations_.size() - free_indices_.size(); }
+
+            template<typename Component, typename... Args>
+            Component& emplace(LveEntity entity, Args&&... args)
+            {
+                assert(valid(entity) && "entity has been destroyed");
+                return pool<Component>().emplace(entity, std::forward<Args>(args)...);
+            }
+
+            template<typename Component>
+            void remove(LveEntity entity)
+            {
+                assert(valid(entity) && "entity has been destroyed");
+                pool<Component>().remove(entity.index);
+            }
+
+            template<typename Component>
+            bool has(LveEntity entity)
+            {
+                return valid(entity) && pool<Component>().contains(entity.index);
+            }
+
+            template<typename Component>
+            Component& get(LveEntity entity)
+            {
+                assert(valid(entity) && "entity has been destroyed");
+                return pool<Component>().get(entity.index);
+            }
+
+            // nullptr if the entity is gone or lacks the component
+            template<typename Component>
+            Component* tryGet(LveEntity entity)
+            {
+                return has<Component>(entity) ? &pool<Component>().get(entity.index) : nullptr;
+            }
+
+            template<typename Component>
+            LveComponentPool<Component>& pool()
+            {
+                const uint32_t type_index = getTypeIndex<Component>();
+                if (type_index >= pools_.size())
+                {
+                    pools_.resize(type_index + 1);
+                }
+                if (pools_[type_index] == nullptr)
+                {
+                    pools_[type_index] = std::make_unique<LveComponentPool<Component>>();
+                }
+                return static_cast<LveComponentPool<Component>&>(*pools_[type_index]);
+            }
+
+            template<typename... Components>
+            LveView<Components...> view()
+            {
+                return LveView<Components...>{pool<Components>()...};
+            }
+
+        private:
+            // dense ids for component types, shared by all registries
+            template<typename Component>
+            static uint32_t getTypeIndex()
+            {
+                static const uint32_t type_index = next_type_index_++;
+                return type_index;
+            }
+
+            inline static std::atomic<uint32_t> next_type_index_{0};
+
+            std::vector<uint32_t> generations_;   // current generation of every slot
+            std::vector<uint32_t> free_indices_;
+            std::vector<std::unique_ptr<LveComponentPoolBase>> pools_;   // indexed by getTypeIndex()
+    };
+}
@@ -1,16 +1,25 @@
 #include "lve_renderer.hpp"
+#include "lve_upload_queue.hpp"
+#include "lve_cpu_profiler.hpp"
 
 #include <stdexcept>
 #include <array>
 
 namespace lve
 {
-    LveRenderer::LveRenderer(LveWindow& window, LveDevice& device): lve_window_(window), lve_device_(device), is_frame_started_(false), current_frame_index_(0)
+    LveRenderer::LveRenderer(LveWindow& window, LveDevice& device): lve_window_(&window), lve_device_(device), frame_ring_buffer_(device, FRAME_RING_BUFFER_SIZE, LveSwapChain::MAX_FRAMES_IN_FLIGHT), gpu_profiler_(device, LveSwapChain::MAX_FRAMES_IN_FLIGHT), secondary_command_buffers_(device, LveSwapChain::MAX_FRAMES_IN_FLIGHT), is_frame_started_(false), current_frame_index_(0)
     {
         recreateSwapChain();
         createCommandBuffers();
     }
 
+    LveRenderer::LveRenderer(LveDevice& device, VkExtent2D extent, VkDeviceSize frame_ring_buffer_size): lve_window_(nullptr), lve_device_(device), frame_ring_buffer_(device, frame_ring_buffer_size, LveSwapChain::MAX_FRAMES_IN_FLIGHT), gpu_profiler_(device, LveSwapChain::MAX_FRAMES_IN_FLIGHT), secondary_command_buffers_(device, LveSwapChain::MAX_FRAMES_IN_FLIGHT), headless_extent_(extent), is_frame_started_(false), current_frame_index_(0)
+    {
+        assert(device.isHeadless() && "Headless LveRenderer requires a headless LveDevice");
+        recreateSwapChain();
+        createCommandBuffers();
+    }
+
     LveRenderer::~LveRenderer()
     {
         freeCommandBuffers();
@@ -19,10 +28,11 @@ namespace lve
     void LveRenderer::recreateSwapChain()
     {
         // pause and wait if any dimension is sizeless (https://youtu.be/0IIqvi3Z0ng?t=352)
-        auto extent = lve_window_.getExtent();
+        auto extent = isHeadless() ? headless_extent_ : lve_window_->getExtent();
         while (extent.width == 0 || extent.height == 0)
         {
-            extent = lve_window_.getExtent();
+            assert(!isHeadless() && "Headless LveRenderer requires a non-zero extent");
+            extent = lve_window_->getExtent();
             glfwWaitEvents();
         }
 
@@ -69,6 +79,10 @@ namespace lve
     VkCommandBuffer LveRenderer::beginFrame()
     {
         assert(!is_frame_started_ && "Cannot call beginFrame() while already in progress");
+        LVE_CPU_ZONE("LveRenderer::beginFrame");
+
+        // kick off whatever uploads were recorded since the last frame as one batch
+        lve_device_.uploadQueue().submit();
 
         auto result = lve_swap_chain_->acquireNextImage(&current_image_index_);
         if (result == VK_ERROR_OUT_OF_DATE_KHR)  // can occur after window has been resized
@@ -83,6 +97,10 @@ namespace lve
 
         is_frame_started_ = true;
 
+        // acquireNextImage() waited on this frame's in-flight fence, so the GPU is done with its region and command buffers
+        frame_ring_buffer_.beginFrame(current_frame_index_);
+        secondary_command_buffers_.beginFrame(current_frame_index_);
+
         auto command_buffer = getCurrentCommandBuffer();
         VkCommandBufferBeginInfo cmd_buffer_begin_info{};
         cmd_buffer_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -90,6 +108,7 @@ namespace lve
         {
             throw std::runtime_error("LveRenderer::beginFrame(): failed to begin recording command buffer");
         }
+        gpu_profiler_.beginFrame(command_buffer, current_frame_index_);
 
         return command_buffer;
     }
@@ -97,17 +116,27 @@ namespace lve
     void LveRenderer::endFrame()
     {
         assert(is_frame_started_ && "Cannot call endFrame() while already in progress");
+        LVE_CPU_ZONE("LveRenderer::endFrame");
 
         auto command_buffer = getCurrentCommandBuffer();
+        gpu_profiler_.endFrame(command_buffer);
+        if (is_readback_enabled_)
+        {
+            lve_swap_chain_->recordReadback(command_buffer, current_image_index_);
+        }
+
         if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS)
         {
             throw std::runtime_error("LveRenderer::endFrame(): failed to record command buffer");
         }
 
         auto result = lve_swap_chain_->submitCommandBuffers(&command_buffer, &current_image_index_);
-        if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || lve_window_.wasWindowResized())
+        last_image_index_ = current_image_index_;
+        has_submitted_frame_ = true;
+
+        if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || (!isHeadless() && lve_window_->wasWindowResized()))
         {
-            lve_window_.resetWindowResizedFlag();
+            lve_window_->resetWindowResizedFlag();
             recreateSwapChain();
         }
         else if (result != VK_SUCCESS)
@@ -119,7 +148,14 @@ namespace lve
         current_frame_index_ = (current_frame_index_ + 1) % LveSwapChain::MAX_FRAMES_IN_FLIGHT;
     }
 
-    void LveRenderer::beginSwapChainRenderPass(VkCommandBuffer command_buffer)
+    void LveRenderer::readbackLastFrame(std::vector<uint8_t>& pixels)
+    {
+        assert(is_readback_enabled_ && "Cannot read back frames unless setReadbackEnabled(true) was called before rendering them");
+        assert(has_submitted_frame_ && "Cannot read back before a frame has been submitted");
+        lve_swap_chain_->readPixels(last_image_index_, pixels);
+    }
+
+    void LveRenderer::beginSwapChainRenderPass(VkCommandBuffer command_buffer, VkSubpassContents contents)
     {
         assert(is_frame_started_ && "Cannot call beginSwapChainRenderPass() while already in progress");
         assert(command_buffer == getCurrentCommandBuffer() && "Cannot begin render pass on command buffer from a different frame");
@@ -141,8 +177,32 @@ namespace lve
         render_pass_begin_info.pClearValues = clear_values.data();
 
         // record to command buffer to begin render pass https://youtu.be/_VOR6q3edig?t=458
-        vkCmdBeginRenderPass(command_buffer, &render_pass_begin_info, VK_SUBPASS_CONTENTS_INLINE);
+        vkCmdBeginRenderPass(command_buffer, &render_pass_begin_info, contents);
+
+        // secondary command buffers do not inherit dynamic state, beginSecondaryCommandBuffer() sets it in each
+        if (contents == VK_SUBPASS_CONTENTS_INLINE)
+        {
+            setViewportAndScissor(command_buffer);
+        }
+    }
+
+    VkCommandBuffer LveRenderer::beginSecondaryCommandBuffer(uint32_t slot)
+    {
+        assert(is_frame_started_ && "Cannot begin secondary command buffer if frame not in progress");
 
+        VkCommandBufferInheritanceInfo inheritance_info{};
+        inheritance_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        inheritance_info.renderPass = lve_swap_chain_->getRenderPass();
+        inheritance_info.subpass = 0;
+        inheritance_info.framebuffer = lve_swap_chain_->getFrameBuffer(current_image_index_);
+
+        VkCommandBuffer command_buffer = secondary_command_buffers_.begin(slot, inheritance_info);
+        setViewportAndScissor(command_buffer);
+        return command_buffer;
+    }
+
+    void LveRenderer::setViewportAndScissor(VkCommandBuffer command_buffer)
+    {
         VkViewport viewport{};
         viewport.x = 0.0f;
         viewport.y = 0.0f;
@@ -153,7 +213,6 @@ namespace lve
         VkRect2D scissor{{0, 0}, lve_swap_chain_->getSwapChainExtent()};
         vkCmdSetViewport(command_buffer, 0, 1, &viewport);
         vkCmdSetScissor(command_buffer, 0, 1, &scissor);
-
     }
 
     void LveRenderer::endSwapChainRenderPass(VkCommandBuffer command_buffer)
@@ -3,6 +3,9 @@
 #include "lve_window.hpp"
 #include "lve_device.hpp"
 #include "lve_swap_chain.hpp"
+#include "lve_frame_ring_buffer.hpp"
+#include "lve_gpu_profiler.hpp"
+#include "lve_secondary_command_buffers.hpp"
 #include "lve_model.hpp"
 
 #include <cassert>
@@ -14,7 +17,11 @@ namespace lve
     class LveRenderer
     {
         public:
+            static constexpr VkDeviceSize FRAME_RING_BUFFER_SIZE = 16 * 1024 * 1024;   // bytes per frame in flight
+
             LveRenderer(LveWindow& window, LveDevice& device);
+            // headless: requires a headless LveDevice, renders into offscreen images of the given extent
+            LveRenderer(LveDevice& device, VkExtent2D extent, VkDeviceSize frame_ring_buffer_size = FRAME_RING_BUFFER_SIZE);
             ~LveRenderer();
 
             // deleting copy operator and copy constructor
@@ -43,21 +50,79 @@ namespace lve
                 return current_frame_index_;
             }
 
+            // per-frame streaming memory, only valid between beginFrame() and endFrame()
+            LveFrameRingBuffer& getFrameRingBuffer()
+            {
+                assert(is_frame_started_ && "Cannot get frame ring buffer if frame not in progress");
+                return frame_ring_buffer_;
+            }
+
+            // timestamps of the whole frame are recorded automatically, open zones with LveGpuProfiler::ScopedZone
+            LveGpuProfiler& getGpuProfiler()
+            {
+                return gpu_profiler_;
+            }
+
+            float getAspectRatio() const
+            {
+                return lve_swap_chain_->extentAspectRatio();
+            }
+
+            bool isHeadless() const
+            {
+                return lve_window_ == nullptr;
+            }
+
+            // headless only: copy every rendered frame into a host visible buffer so readbackLastFrame() can read it
+            void setReadbackEnabled(bool enabled)
+            {
+                assert(isHeadless() && "Readback is only supported by the headless renderer");
+                is_readback_enabled_ = enabled;
+            }
+
+            // headless only: waits for the most recently submitted frame and returns its RGBA8 pixels
+            void readbackLastFrame(std::vector<uint8_t>& pixels);
+
             VkCommandBuffer beginFrame();
             void endFrame();
 
-            void beginSwapChainRenderPass(VkCommandBuffer command_buffer);
+            // with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS the pass may only be filled by vkCmdExecuteCommands
+            // with buffers from beginSecondaryCommandBuffer()
+            void beginSwapChainRenderPass(VkCommandBuffer command_buffer, VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
             void endSwapChainRenderPass(VkCommandBuffer command_buffer);
 
+            // not thread safe: makes slots [0, slot_count) available to beginSecondaryCommandBuffer()
+            void reserveSecondaryCommandBufferSlots(uint32_t slot_count)
+            {
+                secondary_command_buffers_.reserveSlots(slot_count);
+            }
+
+            // secondary command buffer continuing the swap chain render pass of the current frame, with viewport and
+            // scissor already set; threads may record at the same time as long as each uses its own slot
+            VkCommandBuffer beginSecondaryCommandBuffer(uint32_t slot);
+            void endSecondaryCommandBuffer(VkCommandBuffer command_buffer)
+            {
+                secondary_command_buffers_.end(command_buffer);
+            }
+
         private:
             void createCommandBuffers();
             void freeCommandBuffers();
             void recreateSwapChain();
+            void setViewportAndScissor(VkCommandBuffer command_buffer);
 
-            LveWindow& lve_window_;
+            LveWindow* lve_window_;   // nullptr when headless
             LveDevice& lve_device_;
             std::unique_ptr<LveSwapChain> lve_swap_chain_;
             std::vector<VkCommandBuffer> command_buffers_;
+            LveFrameRingBuffer frame_ring_buffer_;
+            LveGpuProfiler gpu_profiler_;
+            LveSecondaryCommandBuffers secondary_command_buffers_;
+
+            VkExtent2D headless_extent_{};
+            bool is_readback_enabled_ = false;
+            bool has_submitted_frame_ = false;
+            uint32_t last_image_index_ = 0;
 
             uint32_t current_image_index_;
             int current_frame_index_;
@@ -0,0 +1,247 @@
+#include "lve_scene_graph.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace lve
+{
+    LveSceneGraph::NodeId LveSceneGraph::createNode(NodeId parent)
+    {
+        assert((parent == NO_NODE || isAlive(parent)) && "parent node has been destroyed");
+
+        NodeId node;
+        if (!free_ids_.empty())
+        {
+            node = free_ids_.back();
+            free_ids_.pop_back();
+        }
+        else
+        {
+            node = static_cast<NodeId>(positions_.size());
+            positions_.push_back(NO_POSITION);
+            parents_.push_back(NO_NODE);
+            first_children_.push_back(NO_NODE);
+            next_siblings_.push_back(NO_NODE);
+        }
+
+        parents_[node] = parent;
+        first_children_[node] = NO_NODE;
+        next_siblings_[node] = NO_NODE;
+        if (parent != NO_NODE)
+        {
+            next_siblings_[node] = first_children_[parent];
+            first_children_[parent] = node;
+        }
+
+        // appended out of order, rebuildOrder() moves it into its level
+        positions_[node] = static_cast<uint32_t>(node_ids_.size());
+        node_ids_.push_back(node);
+        parent_positions_.push_back(NO_POSITION);
+        local_transforms_.emplace_back();
+        world_matrices_.emplace_back(1.0f);
+        dirty_.push_back(1);
+        changed_.push_back(0);
+
+        order_stale_ = true;
+        any_dirty_ = true;
+        return node;
+    }
+
+    void LveSceneGraph::destroyNode(NodeId node)
+    {
+        assert(isAlive(node) && "node has already been destroyed");
+        unlinkFromParent(node);
+
+        // the rows stay until rebuildOrder() drops them, only the ids are released
+        std::vector<NodeId> stack{node};
+        while (!stack.empty())
+        {
+            const NodeId current = stack.back();
+            stack.pop_back();
+            for (NodeId child = first_children_[current]; child != NO_NODE; child = next_siblings_[child])
+            {
+                stack.push_back(child);
+            }
+            positions_[current] = NO_POSITION;
+            free_ids_.push_back(current);
+        }
+        order_stale_ = true;
+    }
+
+    void LveSceneGraph::setParent(NodeId node, NodeId parent)
+    {
+        assert(isAlive(node) && "node has been destroyed");
+        assert((parent == NO_NODE || isAlive(parent)) && "parent node has been destroyed");
+        if (parents_[node] == parent)
+        {
+            return;
+        }
+        for (NodeId ancestor = parent; ancestor != NO_NODE; ancestor = parents_[ancestor])
+        {
+            assert(ancestor != node && "a node cannot become a child of its own subtree");
+        }
+
+        unlinkFromParent(node);
+        parents_[node] = parent;
+        if (parent != NO_NODE)
+        {
+            next_siblings_[node] = first_children_[parent];
+            first_children_[parent] = node;
+        }
+
+        dirty_[positions_[node]] = 1;
+        order_stale_ = true;
+        any_dirty_ = true;
+    }
+
+    LveSceneGraph::NodeId LveSceneGraph::getParent(NodeId node) const
+    {
+        assert(isAlive(node) && "node has been destroyed");
+        return parents_[node];
+    }
+
+    TransformComponent& LveSceneGraph::editLocalTransform(NodeId node)
+    {
+        const uint32_t position = positionOf(node);
+        dirty_[position] = 1;
+        any_dirty_ = true;
+        return local_transforms_[position];
+    }
+
+    void LveSceneGraph::propagate()
+    {
+        propagate([](size_t count, const auto& function) { function(0, count); });
+    }
+
+    uint32_t LveSceneGraph::positionOf(NodeId node) const
+    {
+        assert(isAlive(node) && "node has been destroyed");
+        return positions_[node];
+    }
+
+    void LveSceneGraph::unlinkFromParent(NodeId node)
+    {
+        const NodeId parent = parents_[node];
+        if (parent == NO_NODE)
+        {
+            return;
+        }
+
+        NodeId* link = &first_children_[parent];
+        while (*link != node)
+        {
+            link = &next_siblings_[*link];
+        }
+        *link = next_siblings_[node];
+        next_siblings_[node] = NO_NODE;
+        parents_[node] = NO_NODE;
+    }
+
+    void LveSceneGraph::rebuildOrder()
+    {
+        // breadth first walk over the live hierarchy, rows of destroyed nodes are not reached
+        std::vector<NodeId> order;
+        order.reserve(node_ids_.size());
+        for (NodeId node = 0; node < positions_.size(); node++)
+        {
+            if (isAlive(node) && parents_[node] == NO_NODE)
+            {
+                order.push_back(node);
+            }
+        }
+
+        level_offsets_.clear();
+        level_offsets_.push_back(0);
+        for (size_t level_begin = 0; level_begin < order.size(); )
+        {
+            const size_t level_end = order.size();
+            for (size_t i = level_begin; i < level_end; i++)
+            {
+                for (NodeId child = first_children_[order[i]]; child != NO_NODE; child = next_siblings_[child])
+                {
+                    order.push_back(child);
+                }
+            }
+            level_offsets_.push_back(level_end);
+            level_begin = level_end;
+        }
+
+        std::vector<NodeId> node_ids(order.size());
+        std::vector<uint32_t> parent_positions(order.size());
+        std::vector<TransformComponent> local_transforms(order.size());
+        std::vector<glm::mat4> world_matrices(order.size());
+        std::vector<uint8_t> dirty(order.size());
+        for (size_t i = 0; i < order.size(); i++)
+        {
+            const uint32_t old_position = positions_[order[i]];
+            node_ids[i] = order[i];
+            local_transforms[i] = local_transforms_[old_position];
+            world_matrices[i] = world_matrices_[old_position];
+            dirty[i] = dirty_[old_position];
+        }
+        for (size_t i = 0; i < order.size(); i++)
+        {
+            positions_[order[i]] = static_cast<uint32_t>(i);
+        }
+        for (size_t i = 0; i < order.size(); i++)
+        {
+            const NodeId parent = parents_[order[i]];
+            parent_positions[i] = parent == NO_NODE ? NO_POSITION : positions_[parent];
+        }
+
+        node_ids_ = std::move(node_ids);
+        parent_positions_ = std::move(parent_positions);
+        local_transforms_ = std::move(local_transforms);
+        world_matrices_ = std::move(world_matrices);
+        dirty_ = std::move(dirty);
+        changed_.assign(order.size(), 0);
+        order_stale_ = false;
+    }
+
+    bool LveSceneGraph::beginPropagation()
+    {
+        if (order_stale_)
+        {
+            rebuildOrder();
+        }
+        std::fill(changed_.begin(), changed_.end(), 0);
+        if (!any_dirty_)
+        {
+            return false;
+        }
+
+        // levels above the first dirty node cannot change
+        const size_t first_dirty = std::find(dirty_.begin(), dirty_.end(), 1) - dirty_.begin();
+        if (first_dirty == dirty_.size())
+        {
+            any_dirty_ = false;
+            return false;
+        }
+        first_dirty_level_ = std::upper_bound(level_offsets_.begin(), level_offsets_.end(), first_dirty) - level_offsets_.begin() - 1;
+        return true;
+    }
+
+    void LveSceneGraph::propagateRange(size_t begin, size_t end)
+    {
+        // parents sit in an earlier level, their world matrix and changed flag are final
+        for (size_t i = begin; i < end; i++)
+        {
+            const uint32_t parent = parent_positions_[i];
+            const bool parent_changed = parent != NO_POSITION && changed_[parent];
+            if (!dirty_[i] && !parent_changed)
+            {
+                continue;
+            }
+
+            const glm::mat4& local = local_transforms_[i].mat4();
+            world_matrices_[i] = parent == NO_POSITION ? local : world_matrices_[parent] * local;
+            changed_[i] = 1;
+        }
+    }
+
+    void LveSceneGraph::endPropagation()
+    {
+        std::fill(dirty_.begin(), dirty_.end(), 0);
+        any_dirty_ = false;
+    }
+}
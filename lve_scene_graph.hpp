@@ -0,0 +1,110 @@
+#pragma once
+
+#include "lve_game_object.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace lve
+{
+    /**
+        Parent/child hierarchy of local transforms with cached world matrices.
+        Node data lives in flat arrays sorted breadth first, so every level is a contiguous range and a
+        parent always sits in an earlier level than its children. propagate() walks the levels in
+        order and only recomposes world = parent_world * local for nodes whose local transform was
+        edited or whose parent changed, i.e. the dirty subtrees. Nodes of one level are independent,
+        so each level can be split across threads with a barrier between levels.
+        Structural changes (create, destroy, reparent) only mark the order stale, the arrays are
+        re-sorted once by the next propagate().
+    */
+    class LveSceneGraph
+    {
+        public:
+            using NodeId = uint32_t;
+            static constexpr NodeId NO_NODE = UINT32_MAX;
+
+            LveSceneGraph() = default;
+
+            // deleting copy operator and copy constructor
+            LveSceneGraph(const LveSceneGraph&) = delete;
+            LveSceneGraph &operator=(const LveSceneGraph&) = delete;
+
+            NodeId createNode(NodeId parent = NO_NODE);
+            // destroys the node and its whole subtree
+            void destroyNode(NodeId node);
+            void setParent(NodeId node, NodeId parent);
+            NodeId getParent(NodeId node) const;
+            bool isAlive(NodeId node) const { return node < positions_.size() && positions_[node] != NO_POSITION; }
+
+            // marks the node dirty, its world matrix and those of its subtree are rebuilt by the next propagate()
+            TransformComponent& editLocalTransform(NodeId node);
+            const TransformComponent& getLocalTransform(NodeId node) const { return local_transforms_[positionOf(node)]; }
+
+            // valid after propagate()
+            const glm::mat4& getWorldMatrix(NodeId node) const { return world_matrices_[positionOf(node)]; }
+
+            void propagate();
+
+            /**
+                Same as propagate(), with every level handed to parallel_for(count, function) which has to
+                call function(begin, end) for disjoint ranges covering [0, count) and return once all of
+                them finished.
+            */
+            template<typename ParallelFor>
+            void propagate(ParallelFor&& parallel_for)
+            {
+                if (!beginPropagation())
+                {
+                    return;
+                }
+                for (size_t level = first_dirty_level_; level + 1 < level_offsets_.size(); level++)
+                {
+                    const size_t level_begin = level_offsets_[level];
+                    parallel_for(level_offsets_[level + 1] - level_begin, [this, level_begin](size_t begin, size_t end)
+                    {
+                        propagateRange(level_begin + begin, level_begin + end);
+                    });
+                }
+                endPropagation();
+            }
+
+            // breadth first arrays, valid after propagate(); changed flags tell which world matrices the last
+            // propagate() rebuilt, e.g. to upload only those
+            size_t size() const { return node_ids_.size(); }
+            size_t getLevelCount() const { return level_offsets_.empty() ? 0 : level_offsets_.size() - 1; }
+            const std::vector<glm::mat4>& getWorldMatrices() const { return world_matrices_; }
+            const std::vector<uint8_t>& getChangedFlags() const { return changed_; }
+            NodeId getNodeAt(size_t position) const { return node_ids_[position]; }
+
+        private:
+            static constexpr uint32_t NO_POSITION = UINT32_MAX;
+
+            uint32_t positionOf(NodeId node) const;
+            void unlinkFromParent(NodeId node);
+            void rebuildOrder();
+            bool beginPropagation();   // false when nothing is dirty
+            void propagateRange(size_t begin, size_t end);
+            void endPropagation();
+
+            // per node id, stable across re-sorts
+            std::vector<uint32_t> positions_;   // NO_POSITION for free ids
+            std::vector<NodeId> parents_;
+            std::vector<NodeId> first_children_;
+            std::vector<NodeId> next_siblings_;
+            std::vector<NodeId> free_ids_;
+
+            // per position, breadth first once the order is rebuilt
+            std::vector<NodeId> node_ids_;
+            std::vector<uint32_t> parent_positions_;
+            std::vector<TransformComponent> local_transforms_;
+            std::vector<glm::mat4> world_matrices_;
+            std::vector<uint8_t> dirty_;     // local transform edited since the last propagate()
+            std::vector<uint8_t> changed_;   // world matrix rebuilt by the last propagate()
+            std::vector<size_t> level_offsets_;   // level i spans [level_offsets_[i], level_offsets_[i + 1])
+
+            bool order_stale_ = false;
+            bool any_dirty_ = false;
+            size_t first_dirty_level_ = 0;
+    };
+}
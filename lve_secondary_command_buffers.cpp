@@ -0,0 +1,108 @@
+#include "lve_secondary_command_buffers.hpp"
+
+#include <cassert>
+#include <stdexcept>
+
+namespace lve
+{
+    LveSecondaryCommandBuffers::LveSecondaryCommandBuffers(LveDevice& device, int frame_count) : lve_device_(device), frame_pools_(frame_count)
+    {
+    }
+
+    LveSecondaryCommandBuffers::~LveSecondaryCommandBuffers()
+    {
+        // destroying a pool frees its command buffers
+        for (auto& slot_pools : frame_pools_)
+        {
+            for (auto& slot_pool : slot_pools)
+            {
+                vkDestroyCommandPool(lve_device_.device(), slot_pool.pool, nullptr);
+            }
+        }
+    }
+
+    void LveSecondaryCommandBuffers::beginFrame(int frame_index)
+    {
+        assert(frame_index >= 0 && frame_index < static_cast<int>(frame_pools_.size()) && "frame index out of range");
+        current_frame_index_ = frame_index;
+        for (auto& slot_pool : frame_pools_[frame_index])
+        {
+            if (slot_pool.used_count == 0)
+            {
+                continue;
+            }
+            if (vkResetCommandPool(lve_device_.device(), slot_pool.pool, 0) != VK_SUCCESS)
+            {
+                throw std::runtime_error("LveSecondaryCommandBuffers::beginFrame(): could not reset command pool");
+            }
+            slot_pool.used_count = 0;
+        }
+    }
+
+    void LveSecondaryCommandBuffers::reserveSlots(uint32_t slot_count)
+    {
+        if (slot_count <= slot_count_)
+        {
+            return;
+        }
+
+        VkCommandPoolCreateInfo pool_info{};
+        pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        pool_info.queueFamilyIndex = lve_device_.findPhysicalQueueFamilies().graphicsFamily;
+        pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;   // only reset as a whole
+
+        for (auto& slot_pools : frame_pools_)
+        {
+            slot_pools.resize(slot_count);
+            for (uint32_t slot = slot_count_; slot < slot_count; slot++)
+            {
+                if (vkCreateCommandPool(lve_device_.device(), &pool_info, nullptr, &slot_pools[slot].pool) != VK_SUCCESS)
+                {
+                    throw std::runtime_error("LveSecondaryCommandBuffers::reserveSlots(): could not create command pool");
+                }
+            }
+        }
+        slot_count_ = slot_count;
+    }
+
+    VkCommandBuffer LveSecondaryCommandBuffers::begin(uint32_t slot, const VkCommandBufferInheritanceInfo& inheritance_info)
+    {
+        assert(slot < slot_count_ && "slot has not been reserved");
+        SlotPool& slot_pool = frame_pools_[current_frame_index_][slot];
+
+        if (slot_pool.used_count == slot_pool.command_buffers.size())
+        {
+            VkCommandBufferAllocateInfo alloc_info{};
+            alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            alloc_info.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+            alloc_info.commandPool = slot_pool.pool;
+            alloc_info.commandBufferCount = 1;
+
+            VkCommandBuffer command_buffer;
+            if (vkAllocateCommandBuffers(lve_device_.device(), &alloc_info, &command_buffer) != VK_SUCCESS)
+            {
+                throw std::runtime_error("LveSecondaryCommandBuffers::begin(): could not allocate command buffer");
+            }
+            slot_pool.command_buffers.push_back(command_buffer);
+        }
+        VkCommandBuffer command_buffer = slot_pool.command_buffers[slot_pool.used_count++];
+
+        VkCommandBufferBeginInfo begin_info{};
+        begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        begin_info.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        begin_info.pInheritanceInfo = &inheritance_info;
+        if (vkBeginCommandBuffer(command_buffer, &begin_info) != VK_SUCCESS)
+        {
+            throw std::runtime_error("LveSecondaryCommandBuffers::begin(): could not begin command buffer");
+        }
+        return command_buffer;
+    }
+
+    void LveSecondaryCommandBuffers::end(VkCommandBuffer command_buffer)
+    {
+        if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS)
+        {
+            throw std::runtime_error("LveSecondaryCommandBuffers::end(): could not record command buffer");
+        }
+    }
+}
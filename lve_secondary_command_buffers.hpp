@@ -0,0 +1,52 @@
+#pragma once
+
+#include "lve_device.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace lve
+{
+    /**
+        Command pools for recording secondary command buffers on several threads at once.
+        There is one transient pool per recording slot and frame in flight. Vulkan pools are externally
+        synchronized, so two threads may record at the same time as long as they use different slots.
+        beginFrame() resets all pools of a frame with a single vkResetCommandPool each, and the buffers
+        allocated from them are reused by later frames instead of being freed.
+    */
+    class LveSecondaryCommandBuffers
+    {
+        public:
+            LveSecondaryCommandBuffers(LveDevice& device, int frame_count);
+            ~LveSecondaryCommandBuffers();
+
+            // deleting copy operator and copy constructor
+            LveSecondaryCommandBuffers(const LveSecondaryCommandBuffers&) = delete;
+            LveSecondaryCommandBuffers &operator=(const LveSecondaryCommandBuffers&) = delete;
+
+            // the GPU must be done with the frame's previous command buffers (its in-flight fence signaled)
+            void beginFrame(int frame_index);
+
+            // creates pools until there are slot_count slots, not thread safe, call before recording in parallel
+            void reserveSlots(uint32_t slot_count);
+            uint32_t getSlotCount() const { return slot_count_; }
+
+            // begins a secondary command buffer of the current frame that continues the inherited render pass;
+            // different slots may be used from different threads at the same time
+            VkCommandBuffer begin(uint32_t slot, const VkCommandBufferInheritanceInfo& inheritance_info);
+            void end(VkCommandBuffer command_buffer);
+
+        private:
+            struct SlotPool
+            {
+                VkCommandPool pool = VK_NULL_HANDLE;
+                std::vector<VkCommandBuffer> command_buffers;   // allocated so far, reused after each reset
+                uint32_t used_count = 0;
+            };
+
+            LveDevice& lve_device_;
+            std::vector<std::vector<SlotPool>> frame_pools_;   // [frame][slot]
+            uint32_t slot_count_ = 0;
+            int current_frame_index_ = 0;
+    };
+}
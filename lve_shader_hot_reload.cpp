@@ -0,0 +1,153 @@
+#include "lve_shader_hot_reload.hpp"
+#include "lve_cpu_profiler.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <utility>
+
+namespace lve
+{
+    namespace
+    {
+        bool endsWith(const std::string& text, const std::string& suffix)
+        {
+            return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+        }
+
+        bool isShaderSource(const std::string& path)
+        {
+            return endsWith(path, ".vert") || endsWith(path, ".frag") || endsWith(path, ".comp");
+        }
+    }
+
+    LveShaderHotReload::LveShaderHotReload(LvePipelineCompiler& pipeline_compiler, const std::string& shader_directory) : pipeline_compiler_(pipeline_compiler), watcher_(shader_directory)
+    {
+    }
+
+    LveShaderHotReload::~LveShaderHotReload()
+    {
+        for (auto& entry : entries_)
+        {
+            if (entry->rebuilding != nullptr)
+            {
+                entry->rebuilding->wait();
+            }
+        }
+        // source_compiles_ futures block until their glslc has exited
+    }
+
+    void LveShaderHotReload::watch(std::shared_ptr<LveAsyncPipeline>& slot, const std::string& vertex_shader_filepath, const std::string& frag_shader_filepath, const PipelineConfigInfo& config_info)
+    {
+        assert(slot != nullptr && "slot has to hold a pipeline before it is watched");
+        auto entry = std::make_unique<Entry>();
+        entry->slot = &slot;
+        entry->vertex_shader_filepath = vertex_shader_filepath;
+        entry->frag_shader_filepath = frag_shader_filepath;
+        LvePipeline::copyConfigInfo(config_info, entry->config_info);
+        entries_.push_back(std::move(entry));
+    }
+
+    void LveShaderHotReload::unwatch(std::shared_ptr<LveAsyncPipeline>& slot)
+    {
+        auto it = std::find_if(entries_.begin(), entries_.end(), [&slot](const std::unique_ptr<Entry>& entry) { return entry->slot == &slot; });
+        assert(it != entries_.end() && "slot is not watched");
+        if ((*it)->rebuilding != nullptr)
+        {
+            (*it)->rebuilding->wait();
+        }
+        entries_.erase(it);
+    }
+
+    void LveShaderHotReload::beginFrame(int frame_index)
+    {
+        LVE_CPU_ZONE("LveShaderHotReload::beginFrame");
+        assert(frame_index >= 0 && frame_index < LveSwapChain::MAX_FRAMES_IN_FLIGHT && "frame index out of range");
+
+        // retired when this frame index was last begun, every frame that could still use them has finished since
+        retired_pipelines_[frame_index].clear();
+
+        changed_paths_.clear();
+        watcher_.poll(changed_paths_);
+        for (const auto& path : changed_paths_)
+        {
+            onFileChanged(path);
+        }
+
+        // glslc writes the .spv on success, the watcher reports it and the rebuild starts from there
+        for (auto it = source_compiles_.begin(); it != source_compiles_.end();)
+        {
+            if (it->exit_code.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            {
+                ++it;
+                continue;
+            }
+            if (it->exit_code.get() != 0)
+            {
+                std::cerr << "LveShaderHotReload: could not compile " << it->source_filepath << ", keeping the old pipelines" << std::endl;
+            }
+            it = source_compiles_.erase(it);
+        }
+
+        // frame boundary, nothing has been recorded with the slots yet
+        for (auto& entry : entries_)
+        {
+            // a slot whose first compile is still running is left alone, so nothing retired can still be compiling
+            const bool slot_compiling = (*entry->slot)->getState() == LveAsyncPipeline::State::Compiling;
+            if (entry->rebuilding != nullptr && entry->rebuilding->getState() != LveAsyncPipeline::State::Compiling && !slot_compiling)
+            {
+                if (entry->rebuilding->isFailed())
+                {
+                    std::cerr << "LveShaderHotReload: could not rebuild pipeline of " << entry->vertex_shader_filepath << ": " << entry->rebuilding->getError() << std::endl;
+                }
+                else
+                {
+                    retired_pipelines_[frame_index].push_back(std::move(*entry->slot));
+                    *entry->slot = std::move(entry->rebuilding);
+                    reload_count_++;
+                }
+                entry->rebuilding.reset();
+            }
+
+            // one rebuild per slot at a time, a change during a rebuild starts the next one when it is done
+            if (entry->rebuild_requested && entry->rebuilding == nullptr)
+            {
+                entry->rebuilding = pipeline_compiler_.compileGraphics(entry->vertex_shader_filepath, entry->frag_shader_filepath, entry->config_info);
+                entry->rebuild_requested = false;
+            }
+        }
+    }
+
+    void LveShaderHotReload::onFileChanged(const std::string& path)
+    {
+        if (isShaderSource(path))
+        {
+            const std::string spv_filepath = path + ".spv";
+            if (!isUsedShader(spv_filepath))
+            {
+                return;
+            }
+            const std::string command = std::string(GLSLC) + " \"" + path + "\" -o \"" + spv_filepath + "\"";
+            source_compiles_.push_back({path, std::async(std::launch::async, [command]() { return std::system(command.c_str()); })});
+            return;
+        }
+
+        for (auto& entry : entries_)
+        {
+            if (entry->vertex_shader_filepath == path || entry->frag_shader_filepath == path)
+            {
+                entry->rebuild_requested = true;
+            }
+        }
+    }
+
+    bool LveShaderHotReload::isUsedShader(const std::string& spv_filepath) const
+    {
+        return std::any_of(entries_.begin(), entries_.end(), [&spv_filepath](const std::unique_ptr<Entry>& entry)
+        {
+            return entry->vertex_shader_filepath == spv_filepath || entry->frag_shader_filepath == spv_filepath;
+        });
+    }
+}
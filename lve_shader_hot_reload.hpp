@@ -0,0 +1,79 @@
+#pragma once
+
+#include "lve_pipeline.hpp"
+#include "lve_pipeline_compiler.hpp"
+#include "lve_shader_watcher.hpp"
+#include "lve_swap_chain.hpp"
+
+#include <array>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace lve
+{
+    /**
+        Rebuilds pipelines when their shaders change on disk, without stopping the frame loop.
+        An edited GLSL file is compiled to its .spv with glslc in the background; a changed .spv starts a
+        rebuild of every watched pipeline using it on the LvePipelineCompiler. Finished pipelines are swapped
+        into their slots in beginFrame(), before the frame records anything, and the replaced ones are kept
+        until beginFrame() of the same frame index comes round again. By then the in-flight fence of every
+        frame that could have recorded them has been waited for, so no vkDeviceWaitIdle is needed. A shader
+        that fails to compile is reported on std::cerr and the old pipeline stays in use.
+    */
+    class LveShaderHotReload
+    {
+        public:
+            static constexpr const char* GLSLC = "/usr/local/bin/glslc";   // same compiler as the Makefile
+
+            LveShaderHotReload(LvePipelineCompiler& pipeline_compiler, const std::string& shader_directory = "shaders");
+            // waits for running rebuilds; retired pipelines are destroyed, so the GPU has to be idle
+            ~LveShaderHotReload();
+
+            // deleting copy operator and copy constructor
+            LveShaderHotReload(const LveShaderHotReload&) = delete;
+            LveShaderHotReload &operator=(const LveShaderHotReload&) = delete;
+
+            // slot gets a rebuilt pipeline whenever one of its shaders changes, it has to stay valid until unwatch();
+            // the shader paths have to lie in the watched directory, config_info is copied
+            void watch(std::shared_ptr<LveAsyncPipeline>& slot, const std::string& vertex_shader_filepath, const std::string& frag_shader_filepath, const PipelineConfigInfo& config_info);
+            // waits for a rebuild of slot that is still running, its layout may be destroyed afterwards
+            void unwatch(std::shared_ptr<LveAsyncPipeline>& slot);
+
+            // call after LveRenderer::beginFrame() returned a command buffer and before anything is recorded
+            void beginFrame(int frame_index);
+
+            // pipelines swapped in so far
+            uint32_t getReloadCount() const { return reload_count_; }
+
+        private:
+            struct Entry
+            {
+                std::shared_ptr<LveAsyncPipeline>* slot;
+                std::string vertex_shader_filepath;
+                std::string frag_shader_filepath;
+                PipelineConfigInfo config_info;
+                std::shared_ptr<LveAsyncPipeline> rebuilding;   // replacement being compiled, nullptr if none
+                bool rebuild_requested = false;   // a shader changed since rebuilding was started
+            };
+
+            struct SourceCompile
+            {
+                std::string source_filepath;
+                std::future<int> exit_code;
+            };
+
+            void onFileChanged(const std::string& path);
+            bool isUsedShader(const std::string& spv_filepath) const;
+
+            LvePipelineCompiler& pipeline_compiler_;
+            LveShaderWatcher watcher_;
+            std::vector<std::unique_ptr<Entry>> entries_;   // unique_ptr, config_info must not move
+            std::vector<SourceCompile> source_compiles_;
+            std::array<std::vector<std::shared_ptr<LveAsyncPipeline>>, LveSwapChain::MAX_FRAMES_IN_FLIGHT> retired_pipelines_;
+            std::vector<std::string> changed_paths_;
+            uint32_t reload_count_ = 0;
+    };
+}
@@ -0,0 +1,79 @@
+#include "lve_shader_watcher.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace lve
+{
+    LveShaderWatcher::LveShaderWatcher(const std::string& directory) : directory_(directory)
+    {
+#ifdef __linux__
+        inotify_descriptor_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (inotify_descriptor_ < 0)
+        {
+            std::cerr << "LveShaderWatcher: could not initialize inotify, shaders are not watched" << std::endl;
+            return;
+        }
+        watch_descriptor_ = inotify_add_watch(inotify_descriptor_, directory_.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+        if (watch_descriptor_ < 0)
+        {
+            std::cerr << "LveShaderWatcher: could not watch " << directory_ << std::endl;
+        }
+#endif
+    }
+
+    LveShaderWatcher::~LveShaderWatcher()
+    {
+#ifdef __linux__
+        if (inotify_descriptor_ >= 0)
+        {
+            close(inotify_descriptor_);   // also removes the watch
+        }
+#endif
+    }
+
+    void LveShaderWatcher::poll(std::vector<std::string>& changed_paths)
+    {
+#ifdef __linux__
+        if (!isWatching())
+        {
+            return;
+        }
+
+        const size_t first_new = changed_paths.size();
+        alignas(inotify_event) char buffer[4096];
+        while (true)
+        {
+            const ssize_t length = read(inotify_descriptor_, buffer, sizeof(buffer));
+            if (length <= 0)
+            {
+                break;   // EAGAIN, no more events queued
+            }
+
+            for (ssize_t offset = 0; offset < length;)
+            {
+                const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+                offset += sizeof(inotify_event) + event->len;
+                if (event->len == 0 || (event->mask & IN_ISDIR) != 0)
+                {
+                    continue;
+                }
+
+                // one save usually produces several events for the same file
+                std::string path = directory_ + "/" + event->name;
+                if (std::find(changed_paths.begin() + first_new, changed_paths.end(), path) == changed_paths.end())
+                {
+                    changed_paths.push_back(std::move(path));
+                }
+            }
+        }
+#else
+        (void)changed_paths;
+#endif
+    }
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace lve
+{
+    /**
+        Reports files in a directory that were written or renamed into it, through inotify on Linux.
+        The descriptor is non-blocking, so poll() can run once per frame and returns at once when nothing
+        changed. Editors that save by writing a temporary file and renaming it are caught by the rename.
+        On other platforms nothing is watched and poll() never reports a change.
+    */
+    class LveShaderWatcher
+    {
+        public:
+            explicit LveShaderWatcher(const std::string& directory);
+            ~LveShaderWatcher();
+
+            // deleting copy operator and copy constructor
+            LveShaderWatcher(const LveShaderWatcher&) = delete;
+            LveShaderWatcher &operator=(const LveShaderWatcher&) = delete;
+
+            // false if the directory could not be watched, poll() then reports nothing
+            bool isWatching() const { return watch_descriptor_ >= 0; }
+            const std::string& getDirectory() const { return directory_; }
+
+            // appends the paths (directory + "/" + name) changed since the last call, each one once
+            void poll(std::vector<std::string>& changed_paths);
+
+        private:
+            std::string directory_;
+            int inotify_descriptor_ = -1;
+            int watch_descriptor_ = -1;
+    };
+}
@@ -0,0 +1,142 @@
+#include "lve_simulation.hpp"
+#include "lve_cpu_profiler.hpp"
+#include "lve_job_system.hpp"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include <cassert>
+#include <cmath>
+
+namespace lve
+{
+    namespace
+    {
+        constexpr size_t PARALLEL_RANGE_SIZE = 2048;   // smallest number of objects stepped by one job
+
+        // angles are kept in [0, 2pi) like the spin the render systems used to apply
+        float wrapAngle(float angle)
+        {
+            return glm::mod(angle, glm::two_pi<float>());
+        }
+
+        // shortest signed rotation from -> to, so interpolating across the wrap does not turn the long way round
+        float angleDelta(float from, float to)
+        {
+            return glm::mod(to - from + glm::pi<float>(), glm::two_pi<float>()) - glm::pi<float>();
+        }
+    }
+
+    LveSimulation::LveSimulation(double timestep, uint32_t max_steps_per_frame, LveJobSystem* job_system) : timestep_(timestep), max_steps_per_frame_(max_steps_per_frame), job_system_(job_system)
+    {
+        assert(timestep > 0.0 && "timestep must be positive");
+        assert(max_steps_per_frame > 0 && "at least one step per frame has to be allowed");
+    }
+
+    void LveSimulation::update(LveRegistry& registry, double frame_seconds)
+    {
+        LVE_CPU_ZONE("LveSimulation::update");
+        advance(frame_seconds);
+
+        auto& simulations = registry.pool<SimulationComponent>().getComponents();
+        const auto& entities = registry.pool<SimulationComponent>().getEntities();
+        auto& transforms = registry.pool<TransformComponent>();
+        const float timestep = static_cast<float>(timestep_);
+        const uint32_t step_count = step_count_;
+        const float alpha = alpha_;
+
+        // each range touches only its own entities' components, the pools themselves are not modified
+        forEachRange(simulations.size(), [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; i++)
+            {
+                for (uint32_t s = 0; s < step_count; s++)
+                {
+                    step(simulations[i], timestep);
+                }
+                if (transforms.contains(entities[i].index))
+                {
+                    interpolate(simulations[i], alpha, transforms.get(entities[i].index));
+                }
+            }
+        });
+    }
+
+    void LveSimulation::update(std::vector<SimulationComponent>& simulations, std::vector<LveGameObject>& game_objects, double frame_seconds)
+    {
+        LVE_CPU_ZONE("LveSimulation::update");
+        assert(simulations.size() == game_objects.size() && "one simulation per game object expected");
+        advance(frame_seconds);
+
+        const float timestep = static_cast<float>(timestep_);
+        const uint32_t step_count = step_count_;
+        const float alpha = alpha_;
+        forEachRange(simulations.size(), [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; i++)
+            {
+                for (uint32_t s = 0; s < step_count; s++)
+                {
+                    step(simulations[i], timestep);
+                }
+                interpolate(simulations[i], alpha, game_objects[i].transform_);
+            }
+        });
+    }
+
+    void LveSimulation::step(SimulationComponent& simulation, float timestep)
+    {
+        simulation.previous = simulation.current;
+
+        auto& current = simulation.current;
+        current.translation += simulation.velocity * timestep;
+        current.rotation.x = wrapAngle(current.rotation.x + simulation.angular_velocity.x * timestep);
+        current.rotation.y = wrapAngle(current.rotation.y + simulation.angular_velocity.y * timestep);
+        current.rotation.z = wrapAngle(current.rotation.z + simulation.angular_velocity.z * timestep);
+    }
+
+    void LveSimulation::interpolate(const SimulationComponent& simulation, float alpha, TransformComponent& transform)
+    {
+        // previous + delta * alpha is exact for a resting object, so its cached matrix stays valid
+        const auto& previous = simulation.previous;
+        const auto& current = simulation.current;
+        transform.translation = previous.translation + (current.translation - previous.translation) * alpha;
+        transform.scale = previous.scale + (current.scale - previous.scale) * alpha;
+        transform.rotation.x = previous.rotation.x + angleDelta(previous.rotation.x, current.rotation.x) * alpha;
+        transform.rotation.y = previous.rotation.y + angleDelta(previous.rotation.y, current.rotation.y) * alpha;
+        transform.rotation.z = previous.rotation.z + angleDelta(previous.rotation.z, current.rotation.z) * alpha;
+    }
+
+    void LveSimulation::advance(double frame_seconds)
+    {
+        accumulator_ += frame_seconds;
+        const double due_steps = std::floor(accumulator_ / timestep_);
+        if (due_steps > max_steps_per_frame_)
+        {
+            // too far behind to catch up, keep only the fraction of a step
+            step_count_ = max_steps_per_frame_;
+            accumulator_ = std::fmod(accumulator_, timestep_);
+        }
+        else
+        {
+            step_count_ = static_cast<uint32_t>(due_steps);
+            accumulator_ -= due_steps * timestep_;
+        }
+        alpha_ = static_cast<float>(accumulator_ / timestep_);
+    }
+
+    template<typename Function>
+    void LveSimulation::forEachRange(size_t count, const Function& function)
+    {
+        if (job_system_ != nullptr)
+        {
+            job_system_->parallelFor(count, PARALLEL_RANGE_SIZE, function);
+        }
+        else
+        {
+            function(0, count);
+        }
+    }
+}
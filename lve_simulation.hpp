@@ -0,0 +1,65 @@
+#pragma once
+
+#include "lve_game_object.hpp"
+#include "lve_registry.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace lve
+{
+    class LveJobSystem;
+
+    /**
+        Fixed timestep update stage, decoupled from the frame rate. Real frame time is collected in an
+        accumulator and every full timestep in it runs one step over all SimulationComponents, so the
+        simulation advances at the same rate however fast frames are rendered, and costs the same per
+        simulated second. The rendered pose is previous + alpha * (current - previous), with alpha the
+        fraction of a step left in the accumulator, so motion stays smooth when frames and steps do not
+        line up. At most max_steps_per_frame steps run per update(), a longer stall drops the excess time
+        instead of falling further and further behind.
+    */
+    class LveSimulation
+    {
+        public:
+            static constexpr double DEFAULT_TIMESTEP = 1.0 / 60.0;
+
+            // with a job_system the steps and the interpolation run over ranges of objects in parallel
+            explicit LveSimulation(double timestep = DEFAULT_TIMESTEP, uint32_t max_steps_per_frame = 8, LveJobSystem* job_system = nullptr);
+
+            // deleting copy operator and copy constructor
+            LveSimulation(const LveSimulation&) = delete;
+            LveSimulation &operator=(const LveSimulation&) = delete;
+
+            // advances by frame_seconds of real time, then writes the interpolated pose of every entity with a
+            // SimulationComponent into its TransformComponent
+            void update(LveRegistry& registry, double frame_seconds);
+
+            // same for objects kept outside a registry, simulations[i] drives game_objects[i].transform_
+            void update(std::vector<SimulationComponent>& simulations, std::vector<LveGameObject>& game_objects, double frame_seconds);
+
+            double getTimestep() const { return timestep_; }
+            // steps run by the last update()
+            uint32_t getStepCount() const { return step_count_; }
+            // in [0, 1), how far the rendered pose lies between previous and current
+            float getAlpha() const { return alpha_; }
+
+            static void step(SimulationComponent& simulation, float timestep);
+            static void interpolate(const SimulationComponent& simulation, float alpha, TransformComponent& transform);
+
+        private:
+            // adds frame_seconds to the accumulator and works out step_count_ and alpha_
+            void advance(double frame_seconds);
+            // calls function(begin, end) over [0, count), split across the job system if there is one
+            template<typename Function>
+            void forEachRange(size_t count, const Function& function);
+
+            double timestep_;
+            uint32_t max_steps_per_frame_;
+            LveJobSystem* job_system_;
+
+            double accumulator_ = 0.0;
+            uint32_t step_count_ = 0;
+            float alpha_ = 0.0f;
+    };
+}
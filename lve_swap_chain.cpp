@@ -1,7 +1,9 @@
 #include "lve_swap_chain.hpp"
+#include "lve_cpu_profiler.hpp"
 
 // std
 #include <array>
+#include <cassert>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
@@ -12,19 +14,23 @@
 namespace lve {
 
   LveSwapChain::LveSwapChain(LveDevice &deviceRef, VkExtent2D extent)
-      : device{deviceRef}, windowExtent{extent} {
+      : device{deviceRef}, windowExtent{extent}, headless{deviceRef.isHeadless()} {
     init();
   }
 
   LveSwapChain::LveSwapChain(LveDevice &deviceRef, VkExtent2D extent, std::shared_ptr<LveSwapChain> previous)
-      : device{deviceRef}, windowExtent{extent}, oldSwapChain{previous} {
+      : device{deviceRef}, windowExtent{extent}, headless{deviceRef.isHeadless()}, oldSwapChain{previous} {
     init();
 
     oldSwapChain = nullptr;
   }
 
   void LveSwapChain::init() {
-    createSwapChain();
+    if (headless) {
+      createOffscreenImages();
+    } else {
+      createSwapChain();
+    }
     createImageViews();
     createRenderPass();
     createDepthResources();
@@ -43,10 +49,16 @@ namespace lve {
       swapChain = nullptr;
     }
 
+    for (size_t i = 0; i < offscreenImageAllocations.size(); i++) {
+      device.destroyImage(swapChainImages[i], offscreenImageAllocations[i]);
+      if (readbackBuffers[i] != VK_NULL_HANDLE) {
+        device.destroyBuffer(readbackBuffers[i], readbackAllocations[i]);
+      }
+    }
+
     for (int i = 0; i < depthImages.size(); i++) {
       vkDestroyImageView(device.device(), depthImageViews[i], nullptr);
-      vkDestroyImage(device.device(), depthImages[i], nullptr);
-      vkFreeMemory(device.device(), depthImageMemorys[i], nullptr);
+      device.destroyImage(depthImages[i], depthImageAllocations[i]);
     }
 
     for (auto framebuffer : swapChainFramebuffers) {
@@ -64,13 +76,24 @@ namespace lve {
   }
 
   VkResult LveSwapChain::acquireNextImage(uint32_t *imageIndex) {
-    vkWaitForFences(
-        device.device(),
-        1,
-        &inFlightFences[currentFrame],
-        VK_TRUE,
-        std::numeric_limits<uint64_t>::max());
+    LVE_CPU_ZONE("LveSwapChain::acquireNextImage");
+    {
+      LVE_CPU_ZONE("wait inFlightFences");
+      vkWaitForFences(
+          device.device(),
+          1,
+          &inFlightFences[currentFrame],
+          VK_TRUE,
+          std::numeric_limits<uint64_t>::max());
+    }
+
+    if (headless) {
+      *imageIndex = nextOffscreenImage;
+      nextOffscreenImage = (nextOffscreenImage + 1) % static_cast<uint32_t>(imageCount());
+      return VK_SUCCESS;
+    }
 
+    LVE_CPU_ZONE("vkAcquireNextImageKHR");
     VkResult result = vkAcquireNextImageKHR(
         device.device(),
         swapChain,
@@ -84,7 +107,9 @@ namespace lve {
 
   VkResult LveSwapChain::submitCommandBuffers(
       const VkCommandBuffer *buffers, uint32_t *imageIndex) {
+    LVE_CPU_ZONE("LveSwapChain::submitCommandBuffers");
     if (imagesInFlight[*imageIndex] != VK_NULL_HANDLE) {
+      LVE_CPU_ZONE("wait imagesInFlight");
       vkWaitForFences(device.device(), 1, &imagesInFlight[*imageIndex], VK_TRUE, UINT64_MAX);
     }
     imagesInFlight[*imageIndex] = inFlightFences[currentFrame];
@@ -94,7 +119,7 @@ namespace lve {
 
     VkSemaphore waitSemaphores[] = {imageAvailableSemaphores[currentFrame]};
     VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-    submitInfo.waitSemaphoreCount = 1;
+    submitInfo.waitSemaphoreCount = headless ? 0 : 1;
     submitInfo.pWaitSemaphores = waitSemaphores;
     submitInfo.pWaitDstStageMask = waitStages;
 
@@ -102,13 +127,21 @@ namespace lve {
     submitInfo.pCommandBuffers = buffers;
 
     VkSemaphore signalSemaphores[] = {renderFinishedSemaphores[currentFrame]};
-    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.signalSemaphoreCount = headless ? 0 : 1;
     submitInfo.pSignalSemaphores = signalSemaphores;
 
     vkResetFences(device.device(), 1, &inFlightFences[currentFrame]);
-    if (vkQueueSubmit(device.graphicsQueue(), 1, &submitInfo, inFlightFences[currentFrame]) !=
-        VK_SUCCESS) {
-      throw std::runtime_error("failed to submit draw command buffer!");
+    {
+      LVE_CPU_ZONE("vkQueueSubmit");
+      if (vkQueueSubmit(device.graphicsQueue(), 1, &submitInfo, inFlightFences[currentFrame]) !=
+          VK_SUCCESS) {
+        throw std::runtime_error("failed to submit draw command buffer!");
+      }
+    }
+
+    if (headless) {
+      currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+      return VK_SUCCESS;
     }
 
     VkPresentInfoKHR presentInfo = {};
@@ -123,7 +156,11 @@ namespace lve {
 
     presentInfo.pImageIndices = imageIndex;
 
-    auto result = vkQueuePresentKHR(device.presentQueue(), &presentInfo);
+    VkResult result;
+    {
+      LVE_CPU_ZONE("vkQueuePresentKHR");
+      result = vkQueuePresentKHR(device.presentQueue(), &presentInfo);
+    }
 
     currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
 
@@ -191,6 +228,105 @@ namespace lve {
     swapChainExtent = extent;
   }
 
+  void LveSwapChain::createOffscreenImages() {
+    swapChainImageFormat = OFFSCREEN_IMAGE_FORMAT;
+    swapChainExtent = windowExtent;
+
+    const uint32_t imageCount = MAX_FRAMES_IN_FLIGHT;
+    swapChainImages.resize(imageCount);
+    offscreenImageAllocations.resize(imageCount);
+    readbackBuffers.assign(imageCount, VK_NULL_HANDLE);   // created by the first recordReadback() of each image
+    readbackAllocations.resize(imageCount);
+
+    for (uint32_t i = 0; i < imageCount; i++) {
+      VkImageCreateInfo imageInfo{};
+      imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+      imageInfo.imageType = VK_IMAGE_TYPE_2D;
+      imageInfo.extent.width = swapChainExtent.width;
+      imageInfo.extent.height = swapChainExtent.height;
+      imageInfo.extent.depth = 1;
+      imageInfo.mipLevels = 1;
+      imageInfo.arrayLayers = 1;
+      imageInfo.format = swapChainImageFormat;
+      imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+      imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+      imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+      imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+      imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+      imageInfo.flags = 0;
+
+      device.createImageWithInfo(
+          imageInfo,
+          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+          swapChainImages[i],
+          offscreenImageAllocations[i]);
+    }
+  }
+
+  void LveSwapChain::recordReadback(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+    assert(headless && "readback is only available for headless swap chains");
+
+    // most headless runs never read back, so the host visible buffers only exist once they are needed
+    if (readbackBuffers[imageIndex] == VK_NULL_HANDLE) {
+      device.createBuffer(
+          static_cast<VkDeviceSize>(swapChainExtent.width) * swapChainExtent.height * 4,
+          VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+          readbackBuffers[imageIndex],
+          readbackAllocations[imageIndex]);
+    }
+
+    // the render pass leaves the image in TRANSFER_SRC_OPTIMAL, its outgoing dependency orders the copy after the writes
+    VkBufferImageCopy region{};
+    region.bufferOffset = 0;
+    region.bufferRowLength = 0;
+    region.bufferImageHeight = 0;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageOffset = {0, 0, 0};
+    region.imageExtent = {swapChainExtent.width, swapChainExtent.height, 1};
+    vkCmdCopyImageToBuffer(
+        commandBuffer,
+        swapChainImages[imageIndex],
+        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        readbackBuffers[imageIndex],
+        1,
+        &region);
+
+    VkBufferMemoryBarrier bufferBarrier{};
+    bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    bufferBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    bufferBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    bufferBarrier.buffer = readbackBuffers[imageIndex];
+    bufferBarrier.offset = 0;
+    bufferBarrier.size = VK_WHOLE_SIZE;
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_HOST_BIT,
+        0,
+        0, nullptr,
+        1, &bufferBarrier,
+        0, nullptr);
+  }
+
+  void LveSwapChain::readPixels(uint32_t imageIndex, std::vector<uint8_t> &pixels) {
+    assert(headless && "readback is only available for headless swap chains");
+    assert(readbackBuffers[imageIndex] != VK_NULL_HANDLE && "no readback was recorded for this image");
+
+    if (imagesInFlight[imageIndex] != VK_NULL_HANDLE) {
+      vkWaitForFences(device.device(), 1, &imagesInFlight[imageIndex], VK_TRUE, UINT64_MAX);
+    }
+
+    const size_t byteCount = static_cast<size_t>(swapChainExtent.width) * swapChainExtent.height * 4;
+    pixels.resize(byteCount);
+    memcpy(pixels.data(), readbackAllocations[imageIndex].mapped, byteCount);
+  }
+
   void LveSwapChain::createImageViews() {
     swapChainImageViews.resize(swapChainImages.size());
     for (size_t i = 0; i < swapChainImages.size(); i++) {
@@ -235,7 +371,8 @@ namespace lve {
     colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    colorAttachment.finalLayout =
+        headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
     VkAttachmentReference colorAttachmentRef = {};
     colorAttachmentRef.attachment = 0;
@@ -257,7 +394,21 @@ namespace lve {
         VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
     dependency.dstAccessMask =
         VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    if (headless) {
+      // the clear of an offscreen image waits for the readback copy of the frame that last used it
+      dependency.srcStageMask |= VK_PIPELINE_STAGE_TRANSFER_BIT;
+    }
+
+    // headless: the color writes and the transition to TRANSFER_SRC_OPTIMAL happen before recordReadback() copies
+    VkSubpassDependency readbackDependency = {};
+    readbackDependency.srcSubpass = 0;
+    readbackDependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    readbackDependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    readbackDependency.dstSubpass = VK_SUBPASS_EXTERNAL;
+    readbackDependency.dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    readbackDependency.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
 
+    std::array<VkSubpassDependency, 2> dependencies = {dependency, readbackDependency};
     std::array<VkAttachmentDescription, 2> attachments = {colorAttachment, depthAttachment};
     VkRenderPassCreateInfo renderPassInfo = {};
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
@@ -265,8 +416,8 @@ namespace lve {
     renderPassInfo.pAttachments = attachments.data();
     renderPassInfo.subpassCount = 1;
     renderPassInfo.pSubpasses = &subpass;
-    renderPassInfo.dependencyCount = 1;
-    renderPassInfo.pDependencies = &dependency;
+    renderPassInfo.dependencyCount = headless ? 2 : 1;
+    renderPassInfo.pDependencies = dependencies.data();
 
     if (vkCreateRenderPass(device.device(), &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
       throw std::runtime_error("failed to create render pass!");
@@ -304,7 +455,7 @@ namespace lve {
     VkExtent2D swapChainExtent = getSwapChainExtent();
 
     depthImages.resize(imageCount());
-    depthImageMemorys.resize(imageCount());
+    depthImageAllocations.resize(imageCount());
     depthImageViews.resize(imageCount());
 
     for (int i = 0; i < depthImages.size(); i++) {
@@ -328,7 +479,7 @@ namespace lve {
           imageInfo,
           VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
           depthImages[i],
-          depthImageMemorys[i]);
+          depthImageAllocations[i]);
 
       VkImageViewCreateInfo viewInfo{};
       viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -387,19 +538,19 @@ namespace lve {
       const std::vector<VkPresentModeKHR> &availablePresentModes) {
     for (const auto &availablePresentMode : availablePresentModes) {
       if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
-        std::cout << "Present mode: Mailbox" << std::endl;
+        std::cerr << "Present mode: Mailbox" << std::endl;
         return availablePresentMode;
       }
     }
 
     // for (const auto &availablePresentMode : availablePresentModes) {
     //   if (availablePresentMode == VK_PRESENT_MODE_IMMEDIATE_KHR) {
-    //     std::cout << "Present mode: Immediate" << std::endl;
+    //     std::cerr << "Present mode: Immediate" << std::endl;
     //     return availablePresentMode;
     //   }
     // }
 
-    std::cout << "Present mode: V-Sync" << std::endl;
+    std::cerr << "Present mode: V-Sync" << std::endl;
     return VK_PRESENT_MODE_FIFO_KHR;
   }
 
@@ -15,6 +15,10 @@ namespace lve {
   class LveSwapChain {
   public:
     static constexpr int MAX_FRAMES_IN_FLIGHT = 2;   // https://youtu.be/_VOR6q3edig?t=64
+    static constexpr VkFormat OFFSCREEN_IMAGE_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
+
+    // on a headless LveDevice the swap chain is a ring of offscreen color/depth images instead of a
+    // VkSwapchainKHR; acquire/submit keep the same fences but skip the semaphores and presentation
 
     LveSwapChain(LveDevice &deviceRef, VkExtent2D windowExtent);
     LveSwapChain(LveDevice &deviceRef, VkExtent2D windowExtent, std::shared_ptr<LveSwapChain> previous);
@@ -40,6 +44,14 @@ namespace lve {
     VkResult acquireNextImage(uint32_t *imageIndex);
     VkResult submitCommandBuffers(const VkCommandBuffer *buffers, uint32_t *imageIndex);
 
+    bool isHeadless() const { return headless; }
+
+    // headless only: copy the color image into its host visible readback buffer at the end of a frame,
+    // the buffer is created the first time an image is read back
+    void recordReadback(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+    // headless only: waits for the frame that rendered imageIndex, then copies tightly packed RGBA8 pixels
+    void readPixels(uint32_t imageIndex, std::vector<uint8_t> &pixels);
+
     bool compareSwapFormats(const LveSwapChain& swapChain) const {
       const bool depth_formats_match = swapChain.swapChainDepthFormat == swapChainDepthFormat;
       const bool image_formats_match = swapChain.swapChainImageFormat == swapChainImageFormat;
@@ -49,6 +61,7 @@ namespace lve {
   private:
     void init();
     void createSwapChain();
+    void createOffscreenImages();
     void createImageViews();
     void createDepthResources();
     void createRenderPass();
@@ -70,15 +83,21 @@ namespace lve {
     VkRenderPass renderPass;
 
     std::vector<VkImage> depthImages;
-    std::vector<VkDeviceMemory> depthImageMemorys;
+    std::vector<LveAllocation> depthImageAllocations;
     std::vector<VkImageView> depthImageViews;
     std::vector<VkImage> swapChainImages;
     std::vector<VkImageView> swapChainImageViews;
 
     LveDevice &device;
     VkExtent2D windowExtent;
+    bool headless;
+
+    std::vector<LveAllocation> offscreenImageAllocations;
+    std::vector<VkBuffer> readbackBuffers;
+    std::vector<LveAllocation> readbackAllocations;
+    uint32_t nextOffscreenImage = 0;
 
-    VkSwapchainKHR swapChain;
+    VkSwapchainKHR swapChain = nullptr;
     std::shared_ptr<LveSwapChain> oldSwapChain;
 
     std::vector<VkSemaphore> imageAvailableSemaphores;
@@ -0,0 +1,355 @@
+#include "lve_transform_store.hpp"
+#include "lve_cpu_profiler.hpp"
+#include "lve_job_system.hpp"
+#include "lve_registry.hpp"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace lve
+{
+    namespace
+    {
+        constexpr size_t BLOCK_SIZE = 64;   // transforms per block, a multiple of the widest kernel
+        constexpr size_t PARALLEL_RANGE_SIZE = 4 * BLOCK_SIZE;   // smallest range updateMatrices() hands to a job
+
+        /*
+            sin/cos after Cephes sinf/cosf: |x| is reduced to t in [-pi/4, pi/4] around the nearest even
+            multiple of pi/4, both minimax polynomials are evaluated and the quadrant picks and negates
+            them. All quadrant arithmetic is done on truncated floats, so the AVX kernel needs no AVX2.
+            Accurate to a few ulp for |x| up to about 8000, game object rotations stay within [0, 2pi].
+        */
+        constexpr float FOUR_OVER_PI = 1.27323954473516f;
+        constexpr float PI_OVER_FOUR_1 = 0.78515625f;   // pi/4 split into three parts for an exact reduction
+        constexpr float PI_OVER_FOUR_2 = 2.4187564849853515625e-4f;
+        constexpr float PI_OVER_FOUR_3 = 3.77489497744594108e-8f;
+        constexpr float SIN_C0 = -1.9515295891e-4f;
+        constexpr float SIN_C1 = 8.3321608736e-3f;
+        constexpr float SIN_C2 = -1.6666654611e-1f;
+        constexpr float COS_C0 = 2.443315711809948e-5f;
+        constexpr float COS_C1 = -1.388731625493765e-3f;
+        constexpr float COS_C2 = 4.166664568298827e-2f;
+
+#if defined(__AVX__)
+        constexpr const char* KERNEL_NAME = "avx";
+        constexpr size_t KERNEL_WIDTH = 8;
+
+        void sinCosKernel(const float* angles, size_t count, float* sines, float* cosines)
+        {
+            const __m256 sign_mask = _mm256_set1_ps(-0.0f);
+            auto truncate = [](__m256 v) { return _mm256_cvtepi32_ps(_mm256_cvttps_epi32(v)); };
+            auto polynomial = [](__m256 z, float c0, float c1, float c2)
+            {
+                return _mm256_add_ps(_mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(c0), z), _mm256_set1_ps(c1)), z), _mm256_set1_ps(c2));
+            };
+
+            for (size_t i = 0; i < count; i += 8)
+            {
+                const __m256 x = _mm256_load_ps(angles + i);
+                const __m256 sign_x = _mm256_and_ps(x, sign_mask);
+                const __m256 a = _mm256_andnot_ps(sign_mask, x);
+
+                // octant rounded up to even, then the quadrant r = (octant / 2) mod 4
+                __m256 y = truncate(_mm256_mul_ps(a, _mm256_set1_ps(FOUR_OVER_PI)));
+                const __m256 y_half = truncate(_mm256_mul_ps(y, _mm256_set1_ps(0.5f)));
+                y = _mm256_add_ps(y, _mm256_sub_ps(y, _mm256_add_ps(y_half, y_half)));
+                const __m256 q = _mm256_mul_ps(y, _mm256_set1_ps(0.5f));
+                const __m256 r = _mm256_sub_ps(q, _mm256_mul_ps(_mm256_set1_ps(4.0f), truncate(_mm256_mul_ps(q, _mm256_set1_ps(0.25f)))));
+
+                __m256 t = _mm256_sub_ps(a, _mm256_mul_ps(y, _mm256_set1_ps(PI_OVER_FOUR_1)));
+                t = _mm256_sub_ps(t, _mm256_mul_ps(y, _mm256_set1_ps(PI_OVER_FOUR_2)));
+                t = _mm256_sub_ps(t, _mm256_mul_ps(y, _mm256_set1_ps(PI_OVER_FOUR_3)));
+                const __m256 z = _mm256_mul_ps(t, t);
+                const __m256 s = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(polynomial(z, SIN_C0, SIN_C1, SIN_C2), z), t), t);
+                const __m256 c = _mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(_mm256_mul_ps(polynomial(z, COS_C0, COS_C1, COS_C2), z), z), _mm256_mul_ps(_mm256_set1_ps(0.5f), z)), _mm256_set1_ps(1.0f));
+
+                // odd quadrants swap sin and cos, sin is negative in quadrants 2 and 3, cos in 1 and 2
+                const __m256 r_half = truncate(_mm256_mul_ps(r, _mm256_set1_ps(0.5f)));
+                const __m256 swap = _mm256_cmp_ps(_mm256_sub_ps(r, _mm256_add_ps(r_half, r_half)), _mm256_set1_ps(0.5f), _CMP_GT_OQ);
+                const __m256 sin_negative = _mm256_and_ps(_mm256_cmp_ps(r, _mm256_set1_ps(1.5f), _CMP_GT_OQ), sign_mask);
+                const __m256 cos_negative = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(r, _mm256_set1_ps(0.5f), _CMP_GT_OQ), _mm256_cmp_ps(r, _mm256_set1_ps(2.5f), _CMP_LT_OQ)), sign_mask);
+
+                const __m256 sin_a = _mm256_or_ps(_mm256_and_ps(swap, c), _mm256_andnot_ps(swap, s));
+                const __m256 cos_a = _mm256_or_ps(_mm256_and_ps(swap, s), _mm256_andnot_ps(swap, c));
+                _mm256_store_ps(sines + i, _mm256_xor_ps(sin_a, _mm256_xor_ps(sin_negative, sign_x)));
+                _mm256_store_ps(cosines + i, _mm256_xor_ps(cos_a, cos_negative));
+            }
+        }
+#elif defined(__SSE2__) || defined(_M_X64)
+        constexpr const char* KERNEL_NAME = "sse";
+        constexpr size_t KERNEL_WIDTH = 4;
+
+        void sinCosKernel(const float* angles, size_t count, float* sines, float* cosines)
+        {
+            const __m128 sign_mask = _mm_set1_ps(-0.0f);
+            auto truncate = [](__m128 v) { return _mm_cvtepi32_ps(_mm_cvttps_epi32(v)); };
+            auto polynomial = [](__m128 z, float c0, float c1, float c2)
+            {
+                return _mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(c0), z), _mm_set1_ps(c1)), z), _mm_set1_ps(c2));
+            };
+
+            for (size_t i = 0; i < count; i += 4)
+            {
+                const __m128 x = _mm_load_ps(angles + i);
+                const __m128 sign_x = _mm_and_ps(x, sign_mask);
+                const __m128 a = _mm_andnot_ps(sign_mask, x);
+
+                // octant rounded up to even, then the quadrant r = (octant / 2) mod 4
+                __m128 y = truncate(_mm_mul_ps(a, _mm_set1_ps(FOUR_OVER_PI)));
+                const __m128 y_half = truncate(_mm_mul_ps(y, _mm_set1_ps(0.5f)));
+                y = _mm_add_ps(y, _mm_sub_ps(y, _mm_add_ps(y_half, y_half)));
+                const __m128 q = _mm_mul_ps(y, _mm_set1_ps(0.5f));
+                const __m128 r = _mm_sub_ps(q, _mm_mul_ps(_mm_set1_ps(4.0f), truncate(_mm_mul_ps(q, _mm_set1_ps(0.25f)))));
+
+                __m128 t = _mm_sub_ps(a, _mm_mul_ps(y, _mm_set1_ps(PI_OVER_FOUR_1)));
+                t = _mm_sub_ps(t, _mm_mul_ps(y, _mm_set1_ps(PI_OVER_FOUR_2)));
+                t = _mm_sub_ps(t, _mm_mul_ps(y, _mm_set1_ps(PI_OVER_FOUR_3)));
+                const __m128 z = _mm_mul_ps(t, t);
+                const __m128 s = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(polynomial(z, SIN_C0, SIN_C1, SIN_C2), z), t), t);
+                const __m128 c = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(_mm_mul_ps(polynomial(z, COS_C0, COS_C1, COS_C2), z), z), _mm_mul_ps(_mm_set1_ps(0.5f), z)), _mm_set1_ps(1.0f));
+
+                // odd quadrants swap sin and cos, sin is negative in quadrants 2 and 3, cos in 1 and 2
+                const __m128 r_half = truncate(_mm_mul_ps(r, _mm_set1_ps(0.5f)));
+                const __m128 swap = _mm_cmpgt_ps(_mm_sub_ps(r, _mm_add_ps(r_half, r_half)), _mm_set1_ps(0.5f));
+                const __m128 sin_negative = _mm_and_ps(_mm_cmpgt_ps(r, _mm_set1_ps(1.5f)), sign_mask);
+                const __m128 cos_negative = _mm_and_ps(_mm_and_ps(_mm_cmpgt_ps(r, _mm_set1_ps(0.5f)), _mm_cmplt_ps(r, _mm_set1_ps(2.5f))), sign_mask);
+
+                const __m128 sin_a = _mm_or_ps(_mm_and_ps(swap, c), _mm_andnot_ps(swap, s));
+                const __m128 cos_a = _mm_or_ps(_mm_and_ps(swap, s), _mm_andnot_ps(swap, c));
+                _mm_store_ps(sines + i, _mm_xor_ps(sin_a, _mm_xor_ps(sin_negative, sign_x)));
+                _mm_store_ps(cosines + i, _mm_xor_ps(cos_a, cos_negative));
+            }
+        }
+#elif defined(__ARM_NEON)
+        constexpr const char* KERNEL_NAME = "neon";
+        constexpr size_t KERNEL_WIDTH = 4;
+
+        void sinCosKernel(const float* angles, size_t count, float* sines, float* cosines)
+        {
+            const uint32x4_t sign_mask = vdupq_n_u32(0x80000000);
+            auto truncate = [](float32x4_t v) { return vcvtq_f32_s32(vcvtq_s32_f32(v)); };
+            auto polynomial = [](float32x4_t z, float c0, float c1, float c2)
+            {
+                return vmlaq_f32(vdupq_n_f32(c2), vmlaq_f32(vdupq_n_f32(c1), vdupq_n_f32(c0), z), z);
+            };
+
+            for (size_t i = 0; i < count; i += 4)
+            {
+                const float32x4_t x = vld1q_f32(angles + i);
+                const uint32x4_t sign_x = vandq_u32(vreinterpretq_u32_f32(x), sign_mask);
+                const float32x4_t a = vabsq_f32(x);
+
+                // octant rounded up to even, then the quadrant r = (octant / 2) mod 4
+                float32x4_t y = truncate(vmulq_n_f32(a, FOUR_OVER_PI));
+                const float32x4_t y_half = truncate(vmulq_n_f32(y, 0.5f));
+                y = vaddq_f32(y, vsubq_f32(y, vaddq_f32(y_half, y_half)));
+                const float32x4_t q = vmulq_n_f32(y, 0.5f);
+                const float32x4_t r = vmlsq_n_f32(q, truncate(vmulq_n_f32(q, 0.25f)), 4.0f);
+
+                float32x4_t t = vmlsq_n_f32(a, y, PI_OVER_FOUR_1);
+                t = vmlsq_n_f32(t, y, PI_OVER_FOUR_2);
+                t = vmlsq_n_f32(t, y, PI_OVER_FOUR_3);
+                const float32x4_t z = vmulq_f32(t, t);
+                const float32x4_t s = vmlaq_f32(t, vmulq_f32(polynomial(z, SIN_C0, SIN_C1, SIN_C2), z), t);
+                const float32x4_t c = vaddq_f32(vmlsq_n_f32(vmulq_f32(vmulq_f32(polynomial(z, COS_C0, COS_C1, COS_C2), z), z), z, 0.5f), vdupq_n_f32(1.0f));
+
+                // odd quadrants swap sin and cos, sin is negative in quadrants 2 and 3, cos in 1 and 2
+                const float32x4_t r_half = truncate(vmulq_n_f32(r, 0.5f));
+                const uint32x4_t swap = vcgtq_f32(vsubq_f32(r, vaddq_f32(r_half, r_half)), vdupq_n_f32(0.5f));
+                const uint32x4_t sin_negative = vandq_u32(vcgtq_f32(r, vdupq_n_f32(1.5f)), sign_mask);
+                const uint32x4_t cos_negative = vandq_u32(vandq_u32(vcgtq_f32(r, vdupq_n_f32(0.5f)), vcltq_f32(r, vdupq_n_f32(2.5f))), sign_mask);
+
+                const float32x4_t sin_a = vbslq_f32(swap, c, s);
+                const float32x4_t cos_a = vbslq_f32(swap, s, c);
+                vst1q_f32(sines + i, vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(sin_a), veorq_u32(sin_negative, sign_x))));
+                vst1q_f32(cosines + i, vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(cos_a), cos_negative)));
+            }
+        }
+#else
+        constexpr const char* KERNEL_NAME = "scalar";
+        constexpr size_t KERNEL_WIDTH = 1;
+
+        void sinCosKernel(const float* angles, size_t count, float* sines, float* cosines)
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                sines[i] = std::sin(angles[i]);
+                cosines[i] = std::cos(angles[i]);
+            }
+        }
+#endif
+        static_assert(BLOCK_SIZE % KERNEL_WIDTH == 0, "BLOCK_SIZE must be a multiple of the kernel width");
+    }
+
+    const char* LveTransformStore::getKernelName()
+    {
+        return KERNEL_NAME;
+    }
+
+    uint32_t LveTransformStore::add(const TransformComponent& transform)
+    {
+        const uint32_t index = static_cast<uint32_t>(size());
+        resize(size() + 1);
+        set(index, transform);
+        return index;
+    }
+
+    void LveTransformStore::set(uint32_t index, const TransformComponent& transform)
+    {
+        assert(index < size() && "transform index out of range");
+        translation_x_[index] = transform.translation.x;
+        translation_y_[index] = transform.translation.y;
+        translation_z_[index] = transform.translation.z;
+        rotation_x_[index] = transform.rotation.x;
+        rotation_y_[index] = transform.rotation.y;
+        rotation_z_[index] = transform.rotation.z;
+        scale_x_[index] = transform.scale.x;
+        scale_y_[index] = transform.scale.y;
+        scale_z_[index] = transform.scale.z;
+    }
+
+    TransformComponent LveTransformStore::get(uint32_t index) const
+    {
+        assert(index < size() && "transform index out of range");
+        TransformComponent transform{};
+        transform.translation = {translation_x_[index], translation_y_[index], translation_z_[index]};
+        transform.rotation = {rotation_x_[index], rotation_y_[index], rotation_z_[index]};
+        transform.scale = {scale_x_[index], scale_y_[index], scale_z_[index]};
+        return transform;
+    }
+
+    void LveTransformStore::resize(size_t count)
+    {
+        for (auto* values : {&translation_x_, &translation_y_, &translation_z_, &rotation_x_, &rotation_y_, &rotation_z_})
+        {
+            values->resize(count, 0.0f);
+        }
+        for (auto* values : {&scale_x_, &scale_y_, &scale_z_})
+        {
+            values->resize(count, 1.0f);
+        }
+    }
+
+    void LveTransformStore::writeMatrices(size_t first, size_t count, void* destination, size_t stride) const
+    {
+        LVE_CPU_ZONE("LveTransformStore::writeMatrices");
+        assert(first + count <= size() && "transform range out of bounds");
+        assert(stride >= sizeof(glm::mat4) && "matrices would overlap");
+
+        // angles of one block are copied to aligned, zero padded scratch so the kernel always loads full registers
+        alignas(32) float angles[3][BLOCK_SIZE];
+        alignas(32) float sines[3][BLOCK_SIZE];
+        alignas(32) float cosines[3][BLOCK_SIZE];
+        const float* rotations[3] = {rotation_x_.data(), rotation_y_.data(), rotation_z_.data()};
+
+        auto* bytes = static_cast<unsigned char*>(destination);
+        for (size_t block_start = 0; block_start < count; block_start += BLOCK_SIZE)
+        {
+            const size_t block_count = std::min(BLOCK_SIZE, count - block_start);
+            const size_t padded_count = (block_count + KERNEL_WIDTH - 1) / KERNEL_WIDTH * KERNEL_WIDTH;
+            for (size_t axis = 0; axis < 3; axis++)
+            {
+                std::copy_n(rotations[axis] + first + block_start, block_count, angles[axis]);
+                std::fill(angles[axis] + block_count, angles[axis] + padded_count, 0.0f);
+                sinCosKernel(angles[axis], padded_count, sines[axis], cosines[axis]);
+            }
+
+            // Translate * Ry * Rx * Rz * Scale, see TransformComponent::computeMatrix()
+            for (size_t j = 0; j < block_count; j++)
+            {
+                const size_t i = first + block_start + j;
+                const float s2 = sines[0][j];
+                const float c2 = cosines[0][j];
+                const float s1 = sines[1][j];
+                const float c1 = cosines[1][j];
+                const float s3 = sines[2][j];
+                const float c3 = cosines[2][j];
+
+                float* m = reinterpret_cast<float*>(bytes + (block_start + j) * stride);
+                m[0] = scale_x_[i] * (c1 * c3 + s1 * s2 * s3);
+                m[1] = scale_x_[i] * (c2 * s3);
+                m[2] = scale_x_[i] * (c1 * s2 * s3 - c3 * s1);
+                m[3] = 0.0f;
+                m[4] = scale_y_[i] * (c3 * s1 * s2 - c1 * s3);
+                m[5] = scale_y_[i] * (c2 * c3);
+                m[6] = scale_y_[i] * (c1 * c3 * s2 + s1 * s3);
+                m[7] = 0.0f;
+                m[8] = scale_z_[i] * (c2 * s1);
+                m[9] = scale_z_[i] * (-s2);
+                m[10] = scale_z_[i] * (c1 * c2);
+                m[11] = 0.0f;
+                m[12] = translation_x_[i];
+                m[13] = translation_y_[i];
+                m[14] = translation_z_[i];
+                m[15] = 1.0f;
+            }
+        }
+    }
+    void LveTransformStore::updateMatrices(const std::vector<TransformComponent*>& transforms, LveJobSystem* job_system)
+    {
+        resize(transforms.size());
+        matrices_.resize(transforms.size());
+
+        // ranges touch disjoint transforms and store entries, writeMatrices() keeps its scratch on the stack
+        auto update_range = [this, &transforms](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; i++)
+            {
+                set(static_cast<uint32_t>(i), *transforms[i]);
+            }
+            writeMatrices(begin, end - begin, matrices_.data() + begin, sizeof(glm::mat4));
+            for (size_t i = begin; i < end; i++)
+            {
+                transforms[i]->setMatrix(matrices_[i]);
+            }
+        };
+
+        if (job_system != nullptr)
+        {
+            job_system->parallelFor(transforms.size(), PARALLEL_RANGE_SIZE, update_range);
+        }
+        else
+        {
+            update_range(0, transforms.size());
+        }
+    }
+
+    size_t LveTransformStore::updateDirtyMatrices(std::vector<LveGameObject>& game_objects, LveJobSystem* job_system)
+    {
+        LVE_CPU_ZONE("LveTransformStore::updateDirtyMatrices");
+        dirty_transforms_.clear();
+        for (auto& game_obj : game_objects)
+        {
+            if (game_obj.transform_.isDirty())
+            {
+                dirty_transforms_.push_back(&game_obj.transform_);
+            }
+        }
+        updateMatrices(dirty_transforms_, job_system);
+        return dirty_transforms_.size();
+    }
+
+    size_t LveTransformStore::updateDirtyMatrices(LveRegistry& registry, LveJobSystem* job_system)
+    {
+        LVE_CPU_ZONE("LveTransformStore::updateDirtyMatrices");
+        dirty_transforms_.clear();
+        for (auto& transform : registry.pool<TransformComponent>().getComponents())
+        {
+            if (transform.isDirty())
+            {
+                dirty_transforms_.push_back(&transform);
+            }
+        }
+        updateMatrices(dirty_transforms_, job_system);
+        return dirty_transforms_.size();
+    }
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "lve_game_object.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace lve
+{
+    class LveJobSystem;
+    class LveRegistry;
+
+    /**
+        Transforms in structure of arrays form: translation, rotation and scale each split into
+        contiguous x, y and z arrays. writeMatrices() builds the model matrices of a whole range in
+        blocks: the rotations of a block go through a vectorized sin/cos kernel (AVX, SSE or NEON,
+        picked at compile time like the LveFrustumCuller kernels) and the matrices are written straight
+        to the destination, e.g. mapped instance buffer memory, with an arbitrary stride.
+        Matrices match TransformComponent::computeMatrix().
+    */
+    class LveTransformStore
+    {
+        public:
+            LveTransformStore() = default;
+
+            // deleting copy operator and copy constructor
+            LveTransformStore(const LveTransformStore&) = delete;
+            LveTransformStore &operator=(const LveTransformStore&) = delete;
+
+            // returns the index of the new transform
+            uint32_t add(const TransformComponent& transform);
+            void set(uint32_t index, const TransformComponent& transform);
+            TransformComponent get(uint32_t index) const;
+
+            // new entries are identity transforms
+            void resize(size_t count);
+            void clear() { resize(0); }
+            size_t size() const { return translation_x_.size(); }
+
+            // writes the matrices of [first, first + count) to destination, one glm::mat4 every stride bytes
+            void writeMatrices(size_t first, size_t count, void* destination, size_t stride) const;
+
+            // rebuilds the cached matrices of the given transforms in one batch, replacing the store's contents;
+            // with a job_system the batch is split into ranges built in parallel
+            void updateMatrices(const std::vector<TransformComponent*>& transforms, LveJobSystem* job_system = nullptr);
+
+            // collects every transform whose cached matrix is out of date and rebuilds them with updateMatrices();
+            // run once per frame right after the simulation, so culling and the render systems only read cached
+            // matrices instead of rebuilding them one by one in TransformComponent::mat4(). Returns the rebuilt count
+            size_t updateDirtyMatrices(std::vector<LveGameObject>& game_objects, LveJobSystem* job_system = nullptr);
+            size_t updateDirtyMatrices(LveRegistry& registry, LveJobSystem* job_system = nullptr);
+
+            static const char* getKernelName();
+
+        private:
+            std::vector<float> translation_x_;
+            std::vector<float> translation_y_;
+            std::vector<float> translation_z_;
+            std::vector<float> rotation_x_;
+            std::vector<float> rotation_y_;
+            std::vector<float> rotation_z_;
+            std::vector<float> scale_x_;
+            std::vector<float> scale_y_;
+            std::vector<float> scale_z_;
+
+            std::vector<glm::mat4> matrices_;   // scratch of updateMatrices()
+            std::vector<TransformComponent*> dirty_transforms_;   // scratch of updateDirtyMatrices()
+    };
+}
@@ -0,0 +1,225 @@
+#include "lve_upload_queue.hpp"
+#include "lve_device.hpp"
+#include "lve_cpu_profiler.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace lve
+{
+    LveUploadQueue::LveUploadQueue(LveDevice& device): lve_device_(device)
+    {
+        createCommandPool();
+    }
+
+    LveUploadQueue::~LveUploadQueue()
+    {
+        if (is_recording_)
+        {
+            submit();
+        }
+        for (auto& batch : in_flight_)
+        {
+            vkWaitForFences(lve_device_.device(), 1, &batch.fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+            retireBatch(batch);
+            free_batches_.push_back(std::move(batch));
+        }
+        for (auto& batch : free_batches_)
+        {
+            vkDestroyFence(lve_device_.device(), batch.fence, nullptr);
+        }
+        vkDestroyCommandPool(lve_device_.device(), command_pool_, nullptr);
+    }
+
+    void LveUploadQueue::createCommandPool()
+    {
+        VkCommandPoolCreateInfo pool_info{};
+        pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        pool_info.queueFamilyIndex = lve_device_.transferQueueFamily();
+        pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+        if (vkCreateCommandPool(lve_device_.device(), &pool_info, nullptr, &command_pool_) != VK_SUCCESS)
+        {
+            throw std::runtime_error("LveUploadQueue::createCommandPool(): failed to create command pool");
+        }
+    }
+
+    void LveUploadQueue::copyBuffer(VkBuffer src_buffer, VkBuffer dst_buffer, VkDeviceSize size, VkDeviceSize src_offset, VkDeviceSize dst_offset)
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        beginBatch();
+
+        VkBufferCopy copy_region{};
+        copy_region.srcOffset = src_offset;
+        copy_region.dstOffset = dst_offset;
+        copy_region.size = size;
+        vkCmdCopyBuffer(recording_.command_buffer, src_buffer, dst_buffer, 1, &copy_region);
+    }
+
+    void LveUploadQueue::copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layer_count)
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        beginBatch();
+
+        VkBufferImageCopy region{};
+        region.bufferOffset = 0;
+        region.bufferRowLength = 0;
+        region.bufferImageHeight = 0;
+
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel = 0;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount = layer_count;
+
+        region.imageOffset = {0, 0, 0};
+        region.imageExtent = {width, height, 1};
+
+        vkCmdCopyBufferToImage(recording_.command_buffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+    }
+
+    void LveUploadQueue::releaseAfterUpload(VkBuffer staging_buffer, LveAllocation staging_allocation)
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        beginBatch();
+        recording_.staging_buffers.emplace_back(staging_buffer, staging_allocation);
+    }
+
+    LveUploadQueue::ticket_t LveUploadQueue::pendingTicket()
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        return is_recording_ ? recording_.ticket : last_submitted_ticket_;
+    }
+
+    LveUploadQueue::ticket_t LveUploadQueue::submit()
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        if (!is_recording_)
+        {
+            return last_submitted_ticket_;
+        }
+
+        if (vkEndCommandBuffer(recording_.command_buffer) != VK_SUCCESS)
+        {
+            throw std::runtime_error("LveUploadQueue::submit(): failed to record upload command buffer");
+        }
+
+        VkSubmitInfo submit_info{};
+        submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submit_info.commandBufferCount = 1;
+        submit_info.pCommandBuffers = &recording_.command_buffer;
+
+        if (vkQueueSubmit(lve_device_.transferQueue(), 1, &submit_info, recording_.fence) != VK_SUCCESS)
+        {
+            throw std::runtime_error("LveUploadQueue::submit(): failed to submit upload command buffer");
+        }
+
+        last_submitted_ticket_ = recording_.ticket;
+        in_flight_.push_back(std::move(recording_));
+        recording_ = Batch{};
+        is_recording_ = false;
+
+        return last_submitted_ticket_;
+    }
+
+    bool LveUploadQueue::isComplete(ticket_t ticket)
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        if (ticket > last_submitted_ticket_)
+        {
+            return false;
+        }
+
+        retireCompletedBatches();
+        return std::none_of(in_flight_.begin(), in_flight_.end(), [ticket](const Batch& batch) { return batch.ticket == ticket; });
+    }
+
+    void LveUploadQueue::wait(ticket_t ticket)
+    {
+        std::unique_lock<std::mutex> lock{mutex_};
+        if (ticket > last_submitted_ticket_)
+        {
+            // submit() takes the lock itself
+            lock.unlock();
+            submit();
+            lock.lock();
+        }
+
+        auto it = std::find_if(in_flight_.begin(), in_flight_.end(), [ticket](const Batch& batch) { return batch.ticket == ticket; });
+        if (it != in_flight_.end())
+        {
+            LVE_CPU_ZONE("LveUploadQueue::wait");
+            vkWaitForFences(lve_device_.device(), 1, &it->fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+        }
+        retireCompletedBatches();
+    }
+
+    void LveUploadQueue::beginBatch()
+    {
+        if (is_recording_)
+        {
+            return;
+        }
+
+        if (!free_batches_.empty())
+        {
+            recording_ = std::move(free_batches_.back());
+            free_batches_.pop_back();
+        }
+        else
+        {
+            VkCommandBufferAllocateInfo alloc_info{};
+            alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            alloc_info.commandPool = command_pool_;
+            alloc_info.commandBufferCount = 1;
+
+            VkFenceCreateInfo fence_info{};
+            fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+            if (vkAllocateCommandBuffers(lve_device_.device(), &alloc_info, &recording_.command_buffer) != VK_SUCCESS ||
+                vkCreateFence(lve_device_.device(), &fence_info, nullptr, &recording_.fence) != VK_SUCCESS)
+            {
+                throw std::runtime_error("LveUploadQueue::beginBatch(): failed to create upload batch");
+            }
+        }
+
+        VkCommandBufferBeginInfo begin_info{};
+        begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkBeginCommandBuffer(recording_.command_buffer, &begin_info);
+
+        recording_.ticket = next_ticket_++;
+        is_recording_ = true;
+    }
+
+    void LveUploadQueue::retireCompletedBatches()
+    {
+        auto it = in_flight_.begin();
+        while (it != in_flight_.end())
+        {
+            if (vkGetFenceStatus(lve_device_.device(), it->fence) == VK_SUCCESS)
+            {
+                retireBatch(*it);
+                free_batches_.push_back(std::move(*it));
+                it = in_flight_.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    void LveUploadQueue::retireBatch(Batch& batch)
+    {
+        for (auto& staging : batch.staging_buffers)
+        {
+            lve_device_.destroyBuffer(staging.first, staging.second);
+        }
+        batch.staging_buffers.clear();
+
+        vkResetFences(lve_device_.device(), 1, &batch.fence);
+        vkResetCommandBuffer(batch.command_buffer, 0);
+    }
+}
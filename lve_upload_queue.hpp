@@ -0,0 +1,71 @@
+#pragma once
+
+#include "lve_memory_allocator.hpp"
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace lve
+{
+    class LveDevice;
+
+    /**
+        Records buffer/image copies into one command buffer per batch and submits them to the
+        dedicated transfer queue (or the graphics queue if the device has none).
+        Every submitted batch is identified by a monotonically increasing ticket that callers poll
+        with isComplete(), so nothing stalls the device the way vkQueueWaitIdle did.
+        Staging buffers handed over with releaseAfterUpload() are destroyed once their batch retires.
+    */
+    class LveUploadQueue
+    {
+        public:
+            using ticket_t = uint64_t;
+
+            explicit LveUploadQueue(LveDevice& device);
+            ~LveUploadQueue();
+
+            // deleting copy operator and copy constructor
+            LveUploadQueue(const LveUploadQueue&) = delete;
+            LveUploadQueue &operator=(const LveUploadQueue&) = delete;
+
+            void copyBuffer(VkBuffer src_buffer, VkBuffer dst_buffer, VkDeviceSize size, VkDeviceSize src_offset = 0, VkDeviceSize dst_offset = 0);
+            void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layer_count);
+            void releaseAfterUpload(VkBuffer staging_buffer, LveAllocation staging_allocation);
+
+            // ticket the copies recorded so far will complete under once submitted
+            ticket_t pendingTicket();
+
+            // submits everything recorded since the last call, returns its ticket
+            ticket_t submit();
+
+            bool isComplete(ticket_t ticket);
+            void wait(ticket_t ticket);
+
+        private:
+            struct Batch
+            {
+                VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+                VkFence fence = VK_NULL_HANDLE;
+                ticket_t ticket = 0;
+                std::vector<std::pair<VkBuffer, LveAllocation>> staging_buffers{};
+            };
+
+            void createCommandPool();
+            void beginBatch();
+            void retireCompletedBatches();
+            void retireBatch(Batch& batch);
+
+            LveDevice& lve_device_;
+            VkCommandPool command_pool_;
+
+            std::mutex mutex_;
+            Batch recording_{};
+            bool is_recording_ = false;
+            std::vector<Batch> in_flight_{};
+            std::vector<Batch> free_batches_{};   // command buffers and fences ready for reuse
+
+            ticket_t next_ticket_ = 1;
+            ticket_t last_submitted_ticket_ = 0;
+    };
+}
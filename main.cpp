@@ -1,5 +1,6 @@
 
 #include "first_app.hpp"
+#include "lve_cpu_profiler.hpp"
 
 #include <cstdlib>
 #include <iostream>
@@ -7,6 +8,14 @@
 
 int main()
 {
+    // LVE_CPU_TRACE=trace.json ./VulkanTutorial writes a Chrome trace of the CPU zones on exit
+    const char* trace_path = std::getenv("LVE_CPU_TRACE");
+    if (trace_path != nullptr)
+    {
+        lve::LveCpuProfiler::get().setEnabled(true);
+        lve::LveCpuProfiler::get().setThreadName("main");
+    }
+
     lve::FirstApp app{};
 
     try
@@ -19,5 +28,10 @@ int main()
         return EXIT_FAILURE;
     }
 
+    if (trace_path != nullptr)
+    {
+        lve::LveCpuProfiler::get().saveChromeTrace(trace_path);
+    }
+
     return EXIT_SUCCESS;
 }
\ No newline at end of file
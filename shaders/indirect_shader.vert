@@ -0,0 +1,39 @@
+#version 450
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 color;
+
+layout(location = 0) out vec3 frag_color;
+
+struct ObjectData
+{
+    mat4 transform;
+    vec4 color;
+    vec4 bounding_sphere;
+    uint model_index;
+    uint instance_base;
+    uint padding0;
+    uint padding1;
+};
+
+layout(std430, set = 0, binding = 0) readonly buffer Objects
+{
+    ObjectData objects[];
+};
+
+layout(std430, set = 0, binding = 2) readonly buffer VisibleIndices
+{
+    uint visible_indices[];
+};
+
+layout(push_constant) uniform Push
+{
+    uint instance_base;   // first slot of the drawn model in visible_indices
+} push;
+
+void main()
+{
+    ObjectData object = objects[visible_indices[push.instance_base + gl_InstanceIndex]];
+    gl_Position = object.transform * vec4(position, 1.0);
+    frag_color = color;
+}
\ No newline at end of file
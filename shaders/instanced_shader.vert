@@ -0,0 +1,16 @@
+#version 450
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 color;
+
+// per-instance attributes, a mat4 occupies locations 2 to 5
+layout(location = 2) in mat4 instance_transform;
+layout(location = 6) in vec3 instance_color;
+
+layout(location = 0) out vec3 frag_color;
+
+void main()
+{
+    gl_Position = instance_transform * vec4(position, 1.0);
+    frag_color = color;
+}
\ No newline at end of file
@@ -1,12 +1,14 @@
 #include "simple_render_system.hpp"
+#include "lve_cpu_profiler.hpp"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
-#include <glm/gtc/constants.hpp>
 
+#include <algorithm>
 #include <stdexcept>
 #include <array>
+#include <cstddef>
 
 namespace lve
 {
@@ -16,15 +18,65 @@ namespace lve
         alignas(16) glm::vec3 color;   // alignas(16) needed because of https://youtu.be/wlLGLWI9Fdc?t=498
     };
 
-    SimpleRenderSystem::SimpleRenderSystem(LveDevice& device, VkRenderPass render_pass) : lve_device_(device)
+    // pipeline field of the draw list sort keys
+    constexpr uint32_t SIMPLE_PIPELINE_ID = 0;
+
+    // renderGameObjectsSecondary() does not cut the draw list into slices shorter than this
+    constexpr size_t MIN_DRAWS_PER_SLICE = 1024;
+
+    // per-instance vertex input of instanced_shader.vert, bound at binding 1
+    struct SimpleInstanceData
+    {
+        glm::mat4 transform{1.0f};
+        alignas(16) glm::vec3 color;
+
+        static constexpr uint32_t BINDING = 1;
+
+        static VkVertexInputBindingDescription getBindingDescription()
+        {
+            VkVertexInputBindingDescription binding_description{};
+            binding_description.binding = BINDING;
+            binding_description.stride = sizeof(SimpleInstanceData);
+            binding_description.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+            return binding_description;
+        }
+
+        static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions()
+        {
+            // a mat4 attribute is four vec4 columns in consecutive locations
+            std::vector<VkVertexInputAttributeDescription> attribute_descriptions(5);
+            for (uint32_t column = 0; column < 4; column++)
+            {
+                attribute_descriptions[column].binding = BINDING;
+                attribute_descriptions[column].location = 2 + column;
+                attribute_descriptions[column].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+                attribute_descriptions[column].offset = offsetof(SimpleInstanceData, transform) + column * sizeof(glm::vec4);
+            }
+            attribute_descriptions[4].binding = BINDING;
+            attribute_descriptions[4].location = 6;
+            attribute_descriptions[4].format = VK_FORMAT_R32G32B32_SFLOAT;
+            attribute_descriptions[4].offset = offsetof(SimpleInstanceData, color);
+            return attribute_descriptions;
+        }
+    };
+    static_assert(sizeof(SimpleInstanceData) == SimpleRenderSystem::FRAME_RING_BYTES_PER_OBJECT, "FRAME_RING_BYTES_PER_OBJECT has to match SimpleInstanceData");
+
+    SimpleRenderSystem::SimpleRenderSystem(LveDevice& device, VkRenderPass render_pass, LveJobSystem* job_system, LvePipelineCompiler* pipeline_compiler, LveShaderHotReload* shader_hot_reload) : lve_device_(device), job_system_(job_system), pipeline_compiler_(pipeline_compiler), shader_hot_reload_(shader_hot_reload)
     {
         createPipelineLayout();
         createPipeline(render_pass);
+        createInstancedPipelineLayout();
+        createInstancedPipeline(render_pass);
     }
 
     SimpleRenderSystem::~SimpleRenderSystem()
     {
-        vkDestroyPipelineLayout(lve_device_.device(), pipeline_layout_, nullptr);
+        if (shader_hot_reload_ != nullptr)
+        {
+            shader_hot_reload_->unwatch(lve_pipeline_);
+            shader_hot_reload_->unwatch(instanced_pipeline_);
+        }
+        instanced_pipeline_->wait();   // a background compile still uses the layout
     }
 
     void SimpleRenderSystem::createPipelineLayout()
@@ -35,40 +87,177 @@ namespace lve
             .offset = 0,
             .size = sizeof(SimplePushConstantData)
         };
+        pipeline_layout_ = lve_device_.pipelineRegistry().getPipelineLayout({}, {push_constant_range});
+    }
 
-        VkPipelineLayoutCreateInfo info{};
-        info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-        info.setLayoutCount = 0;
-        info.pSetLayouts = nullptr;
-        info.pushConstantRangeCount = 1;
-        info.pPushConstantRanges = &push_constant_range;
+    void SimpleRenderSystem::createPipeline(VkRenderPass render_pass)
+    {
+        assert(pipeline_layout_ != nullptr && "Cannot create pipeline before pipeline layout");
 
-        if (vkCreatePipelineLayout(lve_device_.device(), &info, nullptr, &pipeline_layout_) != VK_SUCCESS)
+        PipelineConfigInfo pipeline_config_info{};
+        LvePipeline::default_pipeline_config_info_(pipeline_config_info);
+        pipeline_config_info.render_pass = render_pass;
+        pipeline_config_info.pipeline_layout = pipeline_layout_->get();
+        lve_pipeline_ = LvePipelineCompiler::compileGraphicsNow(lve_device_, "shaders/simple_shader.vert.spv", "shaders/simple_shader.frag.spv", pipeline_config_info);
+        if (lve_pipeline_->isFailed())
         {
-            throw std::runtime_error("SimpleRenderSystem::createPipelineLayout(); could not create pipeline layout");
+            throw std::runtime_error("SimpleRenderSystem::createPipeline(); " + lve_pipeline_->getError());
+        }
+        if (shader_hot_reload_ != nullptr)
+        {
+            shader_hot_reload_->watch(lve_pipeline_, "shaders/simple_shader.vert.spv", "shaders/simple_shader.frag.spv", pipeline_config_info);
         }
     }
 
-    void SimpleRenderSystem::createPipeline(VkRenderPass render_pass)
+    void SimpleRenderSystem::createInstancedPipelineLayout()
     {
-        assert(pipeline_layout_ != nullptr && "Cannot create pipeline before pipeline layout");
+        // everything per-object comes from the instance buffer, no push constants or descriptors
+        instanced_pipeline_layout_ = lve_device_.pipelineRegistry().getPipelineLayout({}, {});
+    }
+
+    void SimpleRenderSystem::createInstancedPipeline(VkRenderPass render_pass)
+    {
+        assert(instanced_pipeline_layout_ != nullptr && "Cannot create pipeline before pipeline layout");
 
         PipelineConfigInfo pipeline_config_info{};
         LvePipeline::default_pipeline_config_info_(pipeline_config_info);
         pipeline_config_info.render_pass = render_pass;
-        pipeline_config_info.pipeline_layout = pipeline_layout_;
-        lve_pipeline_ = std::make_unique<LvePipeline>(lve_device_, "shaders/simple_shader.vert.spv", "shaders/simple_shader.frag.spv", pipeline_config_info);
+        pipeline_config_info.pipeline_layout = instanced_pipeline_layout_->get();
+        pipeline_config_info.binding_descriptions.push_back(SimpleInstanceData::getBindingDescription());
+        const auto instance_attributes = SimpleInstanceData::getAttributeDescriptions();
+        pipeline_config_info.attribute_descriptions.insert(pipeline_config_info.attribute_descriptions.end(), instance_attributes.begin(), instance_attributes.end());
+        if (pipeline_compiler_ != nullptr)
+        {
+            instanced_pipeline_ = pipeline_compiler_->compileGraphics("shaders/instanced_shader.vert.spv", "shaders/instanced_shader.frag.spv", pipeline_config_info);
+        }
+        else
+        {
+            instanced_pipeline_ = LvePipelineCompiler::compileGraphicsNow(lve_device_, "shaders/instanced_shader.vert.spv", "shaders/instanced_shader.frag.spv", pipeline_config_info);
+        }
+        if (shader_hot_reload_ != nullptr)
+        {
+            shader_hot_reload_->watch(instanced_pipeline_, "shaders/instanced_shader.vert.spv", "shaders/instanced_shader.frag.spv", pipeline_config_info);
+        }
+    }
+
+    bool SimpleRenderSystem::isInstancedPipelineReady() const
+    {
+        if (instanced_pipeline_->isFailed())
+        {
+            throw std::runtime_error("SimpleRenderSystem::isInstancedPipelineReady(); could not create instanced pipeline: " + instanced_pipeline_->getError());
+        }
+        return instanced_pipeline_->isReady();
+    }
+
+    void SimpleRenderSystem::renderGameObjects(VkCommandBuffer command_buffer, std::vector<LveGameObject>& game_objects, const std::vector<uint32_t>* visible_objects)
+    {
+        LVE_CPU_ZONE("SimpleRenderSystem::renderGameObjects");
+        buildDrawList(game_objects, visible_objects);
+        bind_stats_ = recordDraws(command_buffer, game_objects, 0, draw_list_.size());
+        draw_call_count_ = bind_stats_.draw_count;
+    }
+
+    void SimpleRenderSystem::renderGameObjectsSecondary(VkCommandBuffer command_buffer, LveRenderer& renderer, std::vector<LveGameObject>& game_objects, const std::vector<uint32_t>* visible_objects)
+    {
+        LVE_CPU_ZONE("SimpleRenderSystem::renderGameObjectsSecondary");
+        buildDrawList(game_objects, visible_objects);
+
+        // one slice per thread, each one rebinds pipeline and model so short slices would only add binds
+        const size_t draw_count = draw_list_.size();
+        const size_t max_slices = job_system_ != nullptr ? job_system_->getWorkerCount() + 1 : 1;
+        const size_t slice_count = std::clamp<size_t>(draw_count / MIN_DRAWS_PER_SLICE, 1, max_slices);
+        const size_t slice_size = (draw_count + slice_count - 1) / slice_count;
+        renderer.reserveSecondaryCommandBufferSlots(static_cast<uint32_t>(slice_count));
+        slice_command_buffers_.resize(slice_count);
+        slice_bind_stats_.resize(slice_count);
+
+        // slice i records with slot i, so no two threads share a command pool
+        auto record_slices = [&](size_t first_slice, size_t last_slice)
+        {
+            for (size_t slice = first_slice; slice < last_slice; slice++)
+            {
+                VkCommandBuffer slice_command_buffer = renderer.beginSecondaryCommandBuffer(static_cast<uint32_t>(slice));
+                slice_bind_stats_[slice] = recordDraws(slice_command_buffer, game_objects, slice * slice_size, std::min(draw_count, (slice + 1) * slice_size));
+                renderer.endSecondaryCommandBuffer(slice_command_buffer);
+                slice_command_buffers_[slice] = slice_command_buffer;
+            }
+        };
+        if (job_system_ != nullptr)
+        {
+            job_system_->parallelFor(slice_count, 1, record_slices);
+        }
+        else
+        {
+            record_slices(0, slice_count);
+        }
+
+        vkCmdExecuteCommands(command_buffer, static_cast<uint32_t>(slice_count), slice_command_buffers_.data());
+
+        bind_stats_ = {};
+        for (const auto& slice_stats : slice_bind_stats_)
+        {
+            bind_stats_.draw_count += slice_stats.draw_count;
+            bind_stats_.pipeline_binds += slice_stats.pipeline_binds;
+            bind_stats_.model_binds += slice_stats.model_binds;
+        }
+        draw_call_count_ = bind_stats_.draw_count;
     }
 
-    void SimpleRenderSystem::renderGameObjects(VkCommandBuffer command_buffer, std::vector<LveGameObject>& game_objects)
+    void SimpleRenderSystem::buildDrawList(std::vector<LveGameObject>& game_objects, const std::vector<uint32_t>* visible_objects)
     {
-        lve_pipeline_->bind(command_buffer);
+        draw_list_.clear();
+        const size_t object_count = visible_objects != nullptr ? visible_objects->size() : game_objects.size();
+        draw_list_.reserve(object_count);
+        model_ids_.clear();
+        draw_models_.clear();
+        for (size_t k = 0; k < object_count; k++)
+        {
+            const uint32_t i = visible_objects != nullptr ? (*visible_objects)[k] : static_cast<uint32_t>(k);
+            auto& game_obj = game_objects[i];
+            if (!game_obj.model_->isUploaded())
+            {
+                continue;   // geometry still in flight on the upload queue
+            }
+
+            auto [it, inserted] = model_ids_.try_emplace(game_obj.model_.get(), static_cast<uint32_t>(draw_models_.size()));
+            if (inserted)
+            {
+                draw_models_.push_back(game_obj.model_.get());
+            }
+
+            // there is no camera yet, translation.z already is the depth in [0, 1]; no materials either
+            draw_list_.add(LveDrawList::makeKey(SIMPLE_PIPELINE_ID, it->second, 0, game_obj.transform_.translation.z), i);
+        }
+        draw_list_.sort(job_system_);
+    }
 
-        for (auto& game_obj : game_objects)
+    LveDrawList::BindStats SimpleRenderSystem::recordDraws(VkCommandBuffer command_buffer, std::vector<LveGameObject>& game_objects, size_t begin, size_t end)
+    {
+        LveDrawList::BindStats bind_stats{};
+        uint32_t bound_pipeline = UINT32_MAX;
+        uint32_t bound_model = UINT32_MAX;
+        const auto& items = draw_list_.getItems();
+        for (size_t k = begin; k < end; k++)
         {
-            game_obj.transform_.rotation.y = glm::mod(game_obj.transform_.rotation.y + 0.01f, glm::two_pi<float>());
-            game_obj.transform_.rotation.x = glm::mod(game_obj.transform_.rotation.x + 0.005f, glm::two_pi<float>());
+            const auto& item = items[k];
+            const uint32_t pipeline = LveDrawList::pipelineOf(item.key);
+            if (pipeline != bound_pipeline)
+            {
+                lve_pipeline_->get()->bind(command_buffer);   // SIMPLE_PIPELINE_ID is the only pipeline of this path
+                bound_pipeline = pipeline;
+                bind_stats.pipeline_binds++;
+            }
 
+            const uint32_t model = LveDrawList::modelOf(item.key);
+            if (model != bound_model)
+            {
+                draw_models_[model]->bind(command_buffer);
+                bound_model = model;
+                bind_stats.model_binds++;
+            }
+
+            // every object is in exactly one slice, so rebuilding its cached matrix here is race free
+            auto& game_obj = game_objects[item.object_index];
             SimplePushConstantData push
             {
                 .transform = game_obj.transform_.mat4(),
@@ -77,15 +266,162 @@ namespace lve
 
             vkCmdPushConstants(
                 command_buffer,
-                pipeline_layout_,
+                pipeline_layout_->get(),
                 VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
                 0,
                 sizeof(SimplePushConstantData),
                 &push
             );
 
-            game_obj.model_->bind(command_buffer);
-            game_obj.model_->draw(command_buffer);
+            draw_models_[model]->draw(command_buffer);
+            bind_stats.draw_count++;
+        }
+        return bind_stats;
+    }
+
+    void SimpleRenderSystem::renderGameObjectsInstanced(VkCommandBuffer command_buffer, LveFrameRingBuffer& frame_ring_buffer, std::vector<LveGameObject>& game_objects, const std::vector<uint32_t>* visible_objects)
+    {
+        LVE_CPU_ZONE("SimpleRenderSystem::renderGameObjectsInstanced");
+        if (!isInstancedPipelineReady())
+        {
+            // the per-object pipeline is created up front, so it can draw the frame instead
+            renderGameObjects(command_buffer, game_objects, visible_objects);
+            return;
+        }
+
+        instance_sources_.clear();
+        const size_t object_count = visible_objects != nullptr ? visible_objects->size() : game_objects.size();
+        for (size_t k = 0; k < object_count; k++)
+        {
+            auto& game_obj = game_objects[visible_objects != nullptr ? (*visible_objects)[k] : k];
+            instance_sources_.push_back({&game_obj.transform_.mat4(), game_obj.model_.get(), &game_obj.color_});
+        }
+        recordInstanced(command_buffer, frame_ring_buffer);
+    }
+
+    void SimpleRenderSystem::renderSceneGraphInstanced(VkCommandBuffer command_buffer, LveFrameRingBuffer& frame_ring_buffer, const LveSceneGraph& scene_graph, std::vector<LveGameObject>& game_objects, const std::vector<LveSceneGraph::NodeId>& node_ids)
+    {
+        LVE_CPU_ZONE("SimpleRenderSystem::renderSceneGraphInstanced");
+        assert(node_ids.size() == game_objects.size() && "one scene graph node per game object expected");
+        if (!isInstancedPipelineReady())
+        {
+            // the per-object path draws local transforms, the hierarchy is skipped until the pipeline is compiled
+            draw_call_count_ = 0;
+            bind_stats_ = {};
+            return;
+        }
+
+        instance_sources_.clear();
+        for (size_t i = 0; i < game_objects.size(); i++)
+        {
+            auto& game_obj = game_objects[i];
+            instance_sources_.push_back({&scene_graph.getWorldMatrix(node_ids[i]), game_obj.model_.get(), &game_obj.color_});
+        }
+        recordInstanced(command_buffer, frame_ring_buffer);
+    }
+
+    void SimpleRenderSystem::renderEntitiesInstanced(VkCommandBuffer command_buffer, LveFrameRingBuffer& frame_ring_buffer, LveRegistry& registry, const std::vector<LveEntity>* visible_entities)
+    {
+        LVE_CPU_ZONE("SimpleRenderSystem::renderEntitiesInstanced");
+        if (!isInstancedPipelineReady())
+        {
+            // entities have no per-object path yet, skip them until the pipeline is compiled
+            draw_call_count_ = 0;
+            bind_stats_ = {};
+            return;
+        }
+
+        instance_sources_.clear();
+        if (visible_entities != nullptr)
+        {
+            for (const LveEntity entity : *visible_entities)
+            {
+                auto* transform = registry.tryGet<TransformComponent>(entity);
+                auto* render = registry.tryGet<RenderComponent>(entity);
+                if (transform != nullptr && render != nullptr)
+                {
+                    instance_sources_.push_back({&transform->mat4(), render->model.get(), &render->color});
+                }
+            }
+        }
+        else
+        {
+            registry.view<TransformComponent, RenderComponent>().each([this](LveEntity, TransformComponent& transform, RenderComponent& render)
+            {
+                instance_sources_.push_back({&transform.mat4(), render.model.get(), &render.color});
+            });
+        }
+        recordInstanced(command_buffer, frame_ring_buffer);
+    }
+
+    void SimpleRenderSystem::recordInstanced(VkCommandBuffer command_buffer, LveFrameRingBuffer& frame_ring_buffer)
+    {
+        draw_call_count_ = 0;
+        bind_stats_ = {};
+
+        // first pass: assign every drawable object to the batch of its model and count instances
+        instance_batches_.clear();
+        batch_lookup_.clear();
+        object_batches_.resize(instance_sources_.size());
+        for (size_t k = 0; k < instance_sources_.size(); k++)
+        {
+            const auto& source = instance_sources_[k];
+            if (source.model == nullptr || !source.model->isUploaded())
+            {
+                object_batches_[k] = UINT32_MAX;   // geometry still in flight on the upload queue
+                continue;
+            }
+
+            auto [it, inserted] = batch_lookup_.try_emplace(source.model, static_cast<uint32_t>(instance_batches_.size()));
+            if (inserted)
+            {
+                instance_batches_.push_back({source.model, 0, 0});
+            }
+            object_batches_[k] = it->second;
+            instance_batches_[it->second].instance_count++;
+        }
+        if (instance_batches_.empty())
+        {
+            return;
+        }
+
+        // instances of a batch are contiguous, instance_count is reused as the write cursor below
+        uint32_t instance_total = 0;
+        for (auto& batch : instance_batches_)
+        {
+            batch.first_instance = instance_total;
+            instance_total += batch.instance_count;
+            batch.instance_count = 0;
+        }
+
+        // second pass: write transforms and colors straight into mapped per-frame memory; the matrices were
+        // rebuilt for the frame by LveTransformStore::updateDirtyMatrices() or LveSceneGraph::propagate()
+        const auto range = frame_ring_buffer.allocate(instance_total * sizeof(SimpleInstanceData), alignof(SimpleInstanceData));
+        auto* instances = static_cast<SimpleInstanceData*>(range.mapped);
+        for (size_t k = 0; k < instance_sources_.size(); k++)
+        {
+            if (object_batches_[k] == UINT32_MAX)
+            {
+                continue;
+            }
+
+            const auto& source = instance_sources_[k];
+            auto& batch = instance_batches_[object_batches_[k]];
+            auto& instance = instances[batch.first_instance + batch.instance_count++];
+            instance.transform = *source.transform;
+            instance.color = *source.color;
+        }
+
+        instanced_pipeline_->get()->bind(command_buffer);
+        vkCmdBindVertexBuffers(command_buffer, SimpleInstanceData::BINDING, 1, &range.buffer, &range.offset);
+        for (const auto& batch : instance_batches_)
+        {
+            batch.model->bind(command_buffer);
+            batch.model->draw(command_buffer, batch.instance_count, batch.first_instance);
+            draw_call_count_++;
         }
+        bind_stats_.draw_count = draw_call_count_;
+        bind_stats_.pipeline_binds = 1;
+        bind_stats_.model_binds = draw_call_count_;
     }
 }
\ No newline at end of file
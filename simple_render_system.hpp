@@ -1,10 +1,20 @@
 #pragma once
 
 #include "lve_device.hpp"
+#include "lve_draw_list.hpp"
+#include "lve_frame_ring_buffer.hpp"
 #include "lve_game_object.hpp"
+#include "lve_job_system.hpp"
 #include "lve_pipeline.hpp"
+#include "lve_pipeline_compiler.hpp"
+#include "lve_pipeline_registry.hpp"
+#include "lve_registry.hpp"
+#include "lve_shader_hot_reload.hpp"
+#include "lve_renderer.hpp"
+#include "lve_scene_graph.hpp"
 
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 namespace lve
@@ -12,22 +22,99 @@ namespace lve
     class SimpleRenderSystem
     {
         public:
-            SimpleRenderSystem(LveDevice& device, VkRenderPass render_pass);
+            // frame ring buffer bytes the instanced paths allocate per drawn object
+            static constexpr VkDeviceSize FRAME_RING_BYTES_PER_OBJECT = 80;
+
+            // with a job_system, draw list sorting and secondary command buffer recording are split into parallel jobs;
+            // with a pipeline_compiler the instanced pipeline compiles in the background, until it is ready the
+            // game object path falls back to per-object draws and the entity path draws nothing;
+            // with a shader_hot_reload both pipelines are rebuilt when their shaders change
+            SimpleRenderSystem(LveDevice& device, VkRenderPass render_pass, LveJobSystem* job_system = nullptr, LvePipelineCompiler* pipeline_compiler = nullptr, LveShaderHotReload* shader_hot_reload = nullptr);
             ~SimpleRenderSystem();
 
             // deleting copy operator and copy constructor
             SimpleRenderSystem(const SimpleRenderSystem&) = delete;
             SimpleRenderSystem &operator=(const SimpleRenderSystem&) = delete;
 
-            void renderGameObjects(VkCommandBuffer command_buffer, std::vector<LveGameObject>& game_objects);
+            // visible_objects (e.g. from LveFrustumCuller) restricts drawing to those indices, nullptr draws every object
+
+            // one push constant + draw per object, sorted by model so each model is bound once
+            void renderGameObjects(VkCommandBuffer command_buffer, std::vector<LveGameObject>& game_objects, const std::vector<uint32_t>* visible_objects = nullptr);
+
+            // same draws, the sorted list is cut into slices that are recorded into secondary command buffers in
+            // parallel on the job system and executed by command_buffer; the swap chain render pass has to be
+            // begun with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS
+            void renderGameObjectsSecondary(VkCommandBuffer command_buffer, LveRenderer& renderer, std::vector<LveGameObject>& game_objects, const std::vector<uint32_t>* visible_objects = nullptr);
+
+            // objects sharing a model become one instanced draw, per-object transforms and colors are
+            // streamed into frame_ring_buffer (throws if they do not fit into its per-frame region)
+            void renderGameObjectsInstanced(VkCommandBuffer command_buffer, LveFrameRingBuffer& frame_ring_buffer, std::vector<LveGameObject>& game_objects, const std::vector<uint32_t>* visible_objects = nullptr);
+
+            // instanced path for the entities with a TransformComponent and a RenderComponent
+            void renderEntitiesInstanced(VkCommandBuffer command_buffer, LveFrameRingBuffer& frame_ring_buffer, LveRegistry& registry, const std::vector<LveEntity>* visible_entities = nullptr);
+
+            // instanced path for objects placed by a scene graph: game_objects[i] is drawn with the world matrix of
+            // node_ids[i] instead of its own transform, call after LveSceneGraph::propagate()
+            void renderSceneGraphInstanced(VkCommandBuffer command_buffer, LveFrameRingBuffer& frame_ring_buffer, const LveSceneGraph& scene_graph, std::vector<LveGameObject>& game_objects, const std::vector<LveSceneGraph::NodeId>& node_ids);
+
+            // number of draw commands recorded by the last render call
+            uint32_t getDrawCallCount() const { return draw_call_count_; }
+
+            // binds recorded (and saved by sorting) during the last render call
+            const LveDrawList::BindStats& getBindStats() const { return bind_stats_; }
 
         private:
+            struct InstanceBatch
+            {
+                LveModel* model;
+                uint32_t first_instance;
+                uint32_t instance_count;
+            };
+
+            // one object to be drawn instanced, gathered from game objects or registry components
+            struct InstanceSource
+            {
+                const glm::mat4* transform;
+                LveModel* model;
+                const glm::vec3* color;
+            };
+
             void createPipelineLayout();
             void createPipeline(VkRenderPass render_pass);
+            void createInstancedPipelineLayout();
+            void createInstancedPipeline(VkRenderPass render_pass);
+            // false while the instanced pipeline is compiling, throws if it failed
+            bool isInstancedPipelineReady() const;
+            void recordInstanced(VkCommandBuffer command_buffer, LveFrameRingBuffer& frame_ring_buffer);
+            // fills and sorts draw_list_ for the per-object paths
+            void buildDrawList(std::vector<LveGameObject>& game_objects, const std::vector<uint32_t>* visible_objects);
+            // records draw_list_ items [begin, end), binding pipeline and first model itself
+            LveDrawList::BindStats recordDraws(VkCommandBuffer command_buffer, std::vector<LveGameObject>& game_objects, size_t begin, size_t end);
 
             LveDevice& lve_device_;
+            LveJobSystem* job_system_;
+            LvePipelineCompiler* pipeline_compiler_;
+            LveShaderHotReload* shader_hot_reload_;
+
+            std::shared_ptr<LveAsyncPipeline> lve_pipeline_;   // always compiled up front, swapped by shader_hot_reload_
+            std::shared_ptr<LvePipelineLayout> pipeline_layout_;
+
+            std::shared_ptr<LveAsyncPipeline> instanced_pipeline_;
+            std::shared_ptr<LvePipelineLayout> instanced_pipeline_layout_;
+
+            // reused every frame so grouping does not allocate once the scene is stable
+            std::vector<InstanceSource> instance_sources_;
+            std::vector<InstanceBatch> instance_batches_;
+            std::unordered_map<LveModel*, uint32_t> batch_lookup_;
+            std::vector<uint32_t> object_batches_;
+
+            LveDrawList draw_list_;
+            std::unordered_map<LveModel*, uint32_t> model_ids_;
+            std::vector<LveModel*> draw_models_;   // indexed by the model id stored in the sort key
+            std::vector<VkCommandBuffer> slice_command_buffers_;
+            std::vector<LveDrawList::BindStats> slice_bind_stats_;
 
-            std::unique_ptr<LvePipeline> lve_pipeline_;
-            VkPipelineLayout pipeline_layout_;
+            uint32_t draw_call_count_ = 0;
+            LveDrawList::BindStats bind_stats_{};
     };
 }
\ No newline at end of file